@@ -27,37 +27,6 @@
 #include <stdlib.h>
 #include <wtf/Assertions.h>
 #include <wtf/Platform.h>
-
-// We do not support Unicode
-namespace WTF {
-namespace Unicode {
-
-enum {
-    Mark_NonSpacing,
-    Mark_SpacingCombining,
-    Number_DecimalDigit,
-    Letter_Uppercase,
-    Letter_Lowercase,
-    Letter_Titlecase,
-    Letter_Modifier,
-    Letter_Other,
-    Punctuation_Connector,
-};
-
-int category(int ch);
-bool isSeparatorSpace(int ch);
-
-inline int category(int ch)
-{
-    return 0;
-}
-
-inline bool isSeparatorSpace(int ch)
-{
-    return false;
-}
-
-} // namespace Unicode
-} // namespace WTF
+#include <wtf/Unicode.h>
 
 #endif
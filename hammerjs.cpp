@@ -37,7 +37,10 @@
 #include <iostream>
 
 #include <JSGlobalData.h>
+#include <ParserProfiler.h>
 #include <SourceCode.h>
+#include <SyntaxTree.h>
+#include <TreeCensus.h>
 #include <UString.h>
 
 using namespace v8;
@@ -50,6 +53,7 @@ static Handle<Value> fs_list(const Arguments& args);
 static Handle<Value> fs_open(const Arguments& args);
 static Handle<Value> fs_workingDirectory(const Arguments& args);
 
+static Handle<Value> reflect_census(const Arguments& args);
 static Handle<Value> reflect_parse(const Arguments& args);
 
 static Handle<Value> stream_constructor(const Arguments& args);
@@ -63,6 +67,13 @@ static Handle<Value> system_execute(const Arguments& args);
 static Handle<Value> system_exit(const Arguments& args);
 static Handle<Value> system_print(const Arguments& args);
 
+#if ENABLE(PARSER_PROFILING)
+static void dumpParserProfile()
+{
+    JSC::ParserProfiler::dump(stderr);
+}
+#endif
+
 static void CleanupStream(Persistent<Value>, void *data)
 {
     delete reinterpret_cast<std::fstream*>(data);
@@ -75,6 +86,11 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+#if ENABLE(PARSER_PROFILING)
+    // system.exit() may end the script early.
+    atexit(dumpParserProfile);
+#endif
+
     FILE* f = fopen(argv[1], "r");
     if (!f) {
         std::cerr << "Error: unable to open file " << argv[1] << std::endl;
@@ -107,6 +123,7 @@ int main(int argc, char* argv[])
 
     // 'Reflect' object
     Handle<FunctionTemplate> reflectObject = FunctionTemplate::New();
+    reflectObject->Set(String::New("census"), FunctionTemplate::New(reflect_census)->GetFunction());
     reflectObject->Set(String::New("parse"), FunctionTemplate::New(reflect_parse)->GetFunction());
     context->Global()->Set(String::New("Reflect"), reflectObject->GetFunction());
 
@@ -248,29 +265,26 @@ static Handle<Value> fs_open(const Arguments& args)
     return result;
 }
 
-static Handle<Value> reflect_parse(const Arguments& args)
+// Pure ASCII code is lexed straight from its UTF-8 bytes, which must outlive
+// the returned provider. Anything else is decoded to UTF-16 first.
+static JSC::SourceProvider* createSourceProvider(Handle<Value> value, const String::Utf8Value& code)
 {
-    if (args.Length() != 1)
-        return ThrowException(String::New("Exception: Reflect.parse() accepts 1 argument"));
-
-    String::Utf8Value code(args[0]);
-    UChar *content = new UChar[code.length()];
-    for (int i = 0; i < code.length(); ++i)
-        content[i] = (*code)[i];
-    JSC::UString scriptCode = JSC::UString(content, code.length());
-    delete [] content;
-
-    JSC::JSGlobalData* globalData = new JSC::JSGlobalData;
-    JSC::UString tree = globalData->parser->createSyntaxTree(globalData, JSC::makeSource(scriptCode));
-    delete globalData;
-
-    if (tree.length() == 0)
-        return Undefined();
+    const char* characters = *code;
+    for (int i = 0; i < code.length(); ++i) {
+        if (characters[i] & 0x80) {
+            String::Value content(value);
+            return new JSC::UStringSourceProvider(JSC::UString(*content, content.length()), JSC::UString());
+        }
+    }
+    return new JSC::Latin1SourceProvider(reinterpret_cast<const LChar*>(characters), code.length(), JSC::UString());
+}
 
-    char *buffer = new char[tree.length() + 1];
-    buffer[tree.length()] = '\0';
-    const UChar *uchars = tree.characters();
-    for (size_t i = 0; i < tree.length(); ++i)
+static Handle<Value> parseJSON(const JSC::UString& json)
+{
+    char *buffer = new char[json.length() + 1];
+    buffer[json.length()] = '\0';
+    const UChar *uchars = json.characters();
+    for (size_t i = 0; i < json.length(); ++i)
         buffer[i] = uchars[i];
 
     Handle<ObjectTemplate> global = ObjectTemplate::New();
@@ -283,6 +297,80 @@ static Handle<Value> reflect_parse(const Arguments& args)
     return script->Run();
 }
 
+static Handle<Value> reflect_census(const Arguments& args)
+{
+    if (args.Length() != 1)
+        return ThrowException(String::New("Exception: Reflect.census() accepts 1 argument"));
+
+    String::Utf8Value code(args[0]);
+    JSC::SourceCode source(createSourceProvider(args[0], code));
+
+    JSC::JSGlobalData* globalData = new JSC::JSGlobalData;
+    JSC::SyntaxTree::Program* program = globalData->parser->parse(globalData, source);
+    if (!program) {
+        delete globalData;
+        return Undefined();
+    }
+
+    JSC::TreeCensus census;
+    census.take(program);
+    delete program;
+    delete globalData;
+
+    return parseJSON(census.toJSON());
+}
+
+static bool optionEnabled(const Arguments& args, int index, const char* name)
+{
+    if (args.Length() <= index || !args[index]->IsObject())
+        return false;
+    return args[index]->ToObject()->Get(String::New(name))->BooleanValue();
+}
+
+static Handle<Value> reflect_parse(const Arguments& args)
+{
+    if (args.Length() < 1 || args.Length() > 2)
+        return ThrowException(String::New("Exception: Reflect.parse() accepts 1 or 2 arguments"));
+
+    String::Utf8Value code(args[0]);
+    JSC::SourceCode source(createSourceProvider(args[0], code));
+
+    unsigned options = JSC::Parser::NoParseOptions;
+    if (optionEnabled(args, 1, "fold"))
+        options |= JSC::Parser::FoldConstants;
+    if (optionEnabled(args, 1, "lazy"))
+        options |= JSC::Parser::LazyFunctionBodies;
+    if (optionEnabled(args, 1, "parallel"))
+        options |= JSC::Parser::ParallelFunctionBodies;
+    bool tolerant = optionEnabled(args, 1, "tolerant");
+    if (tolerant)
+        options |= JSC::Parser::RecoverFromErrors;
+
+    JSC::JSGlobalData* globalData = new JSC::JSGlobalData;
+    Vector<JSC::ParseDiagnostic> diagnostics;
+    JSC::UString tree = globalData->parser->createSyntaxTree(globalData, source, options, 0, 0, &diagnostics);
+    delete globalData;
+
+    if (tree.length() == 0)
+        return Undefined();
+
+    Handle<Value> result = parseJSON(tree);
+    if (!tolerant)
+        return result;
+
+    Handle<Array> errors = Array::New(diagnostics.size());
+    for (size_t i = 0; i < diagnostics.size(); ++i) {
+        JSC::UString message = JSC::Parser::diagnosticMessage(diagnostics[i]);
+        Handle<Object> error = Object::New();
+        error->Set(String::New("index"), Integer::New(diagnostics[i].offset));
+        error->Set(String::New("lineNumber"), Integer::New(diagnostics[i].line));
+        error->Set(String::New("description"), String::New(message.characters(), message.length()));
+        errors->Set(i, error);
+    }
+    result->ToObject()->Set(String::New("errors"), errors);
+    return result;
+}
+
 static Handle<Value> fs_workingDirectory(const Arguments& args)
 {
     if (args.Length() != 0)
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "BraceMatches.h"
+
+#include <algorithm>
+
+namespace JSC {
+
+static bool openBraceLessThan(const BraceMatches::Match& match, int openBrace)
+{
+    return match.openBrace < openBrace;
+}
+
+const BraceMatches::Match* BraceMatches::find(int openBrace) const
+{
+    const Match* begin = m_matches.data();
+    const Match* end = begin + m_matches.size();
+    const Match* match = std::lower_bound(begin, end, openBrace, openBraceLessThan);
+    if (match == end || match->openBrace != openBrace || match->closeBrace < 0)
+        return 0;
+    return match;
+}
+
+void BraceMatches::splice(int start, int end, int delta, int lineDelta, const BraceMatches& matches)
+{
+    Vector<Match> spliced;
+    spliced.reserveInitialCapacity(m_matches.size() + matches.m_matches.size());
+
+    size_t i = 0;
+    for (; i < m_matches.size() && m_matches[i].openBrace < start; ++i) {
+        Match match = m_matches[i];
+        // Braces around the range now close further on.
+        if (match.closeBrace >= end) {
+            match.closeBrace += delta;
+            match.lineCount += lineDelta;
+        }
+        spliced.append(match);
+    }
+    spliced.append(matches.m_matches);
+    for (; i < m_matches.size(); ++i) {
+        Match match = m_matches[i];
+        if (match.openBrace < end)
+            continue;
+        match.openBrace += delta;
+        match.closeBrace += delta;
+        spliced.append(match);
+    }
+
+    m_matches.swap(spliced);
+}
+
+} // namespace JSC
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BraceMatches_h
+#define BraceMatches_h
+
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// The braces paired up by the lexer while it skipped function bodies, in the
+// order of the opening braces. When a skipped body is parsed later, the bodies
+// nested in it are skipped again by jumping to their recorded closing brace
+// instead of scanning them once more.
+class BraceMatches : public Noncopyable
+{
+public:
+    struct Match {
+        int openBrace;
+        int closeBrace;
+        int lineCount;
+    };
+
+    // Records an opening brace and returns the index to close it with.
+    size_t open(int openBrace)
+    {
+        Match match = { openBrace, -1, 0 };
+        m_matches.append(match);
+        return m_matches.size() - 1;
+    }
+
+    void close(size_t index, int closeBrace, int lineCount)
+    {
+        m_matches[index].closeBrace = closeBrace;
+        m_matches[index].lineCount = lineCount;
+    }
+
+    // Forgets all braces, keeping the memory.
+    void reset() { m_matches.shrink(0); }
+
+    // Forgets the braces recorded after the first count.
+    size_t size() const { return m_matches.size(); }
+    void shrink(size_t count) { m_matches.shrink(count); }
+
+    // The match of the brace at the given offset, or 0 if it was not skipped.
+    const Match* find(int openBrace) const;
+
+    // After the characters from start to end were replaced by delta more
+    // characters holding lineDelta more lines: drops the braces opened inside
+    // the old range, adds those of matches, and moves the later ones.
+    void splice(int start, int end, int delta, int lineDelta, const BraceMatches& matches);
+
+private:
+    Vector<Match> m_matches;
+};
+
+} // namespace JSC
+
+#endif // BraceMatches_h
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CharacterScanner_h
+#define CharacterScanner_h
+
+#include <wtf/AlwaysInline.h>
+#include <wtf/Assertions.h>
+#include <wtf/Platform.h>
+
+#if CPU(X86_AVX2)
+#include <immintrin.h>
+#elif CPU(X86_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace JSC {
+
+// Searches used by the lexer's inner loops: comments, string bodies and runs
+// of indentation. Each returns the first character in [start, end) that the
+// lexer has to look at, or end. Where the target has SIMD, 16 or 32 bytes are
+// examined per step; the remaining tail is scanned one character at a time.
+
+#if CPU(X86_SSE2) || CPU(X86_AVX2)
+#define ENABLE_SIMD_SCANNERS 1
+
+static ALWAYS_INLINE unsigned countTrailingZeros(unsigned mask)
+{
+    ASSERT(mask);
+#if COMPILER(GCC)
+    return __builtin_ctz(mask);
+#else
+    unsigned count = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Vector operations over 8-bit and 16-bit characters. equal() yields a lane of
+// all ones for every match; mask() packs one bit per byte of the vector.
+template <typename T> struct CharacterVector;
+
+template <> struct CharacterVector<LChar> {
+#if CPU(X86_AVX2)
+    typedef __m256i Type;
+    static const int length = 32;
+    static ALWAYS_INLINE Type load(const LChar* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static ALWAYS_INLINE Type splat(int c) { return _mm256_set1_epi8(static_cast<char>(c)); }
+    static ALWAYS_INLINE Type equal(Type a, Type b) { return _mm256_cmpeq_epi8(a, b); }
+    static ALWAYS_INLINE Type either(Type a, Type b) { return _mm256_or_si256(a, b); }
+    static ALWAYS_INLINE unsigned mask(Type v) { return static_cast<unsigned>(_mm256_movemask_epi8(v)); }
+    static const unsigned fullMask = 0xFFFFFFFFU;
+#else
+    typedef __m128i Type;
+    static const int length = 16;
+    static ALWAYS_INLINE Type load(const LChar* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static ALWAYS_INLINE Type splat(int c) { return _mm_set1_epi8(static_cast<char>(c)); }
+    static ALWAYS_INLINE Type equal(Type a, Type b) { return _mm_cmpeq_epi8(a, b); }
+    static ALWAYS_INLINE Type either(Type a, Type b) { return _mm_or_si128(a, b); }
+    static ALWAYS_INLINE unsigned mask(Type v) { return static_cast<unsigned>(_mm_movemask_epi8(v)); }
+    static const unsigned fullMask = 0xFFFFU;
+#endif
+    static ALWAYS_INLINE unsigned index(unsigned mask) { return countTrailingZeros(mask); }
+
+    // Latin-1 has no U+2028 or U+2029.
+    static ALWAYS_INLINE Type lineOrParagraphSeparator(Type) { return splat(0); }
+};
+
+template <> struct CharacterVector<UChar> {
+#if CPU(X86_AVX2)
+    typedef __m256i Type;
+    static const int length = 16;
+    static ALWAYS_INLINE Type load(const UChar* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static ALWAYS_INLINE Type splat(int c) { return _mm256_set1_epi16(static_cast<short>(c)); }
+    static ALWAYS_INLINE Type equal(Type a, Type b) { return _mm256_cmpeq_epi16(a, b); }
+    static ALWAYS_INLINE Type either(Type a, Type b) { return _mm256_or_si256(a, b); }
+    static ALWAYS_INLINE Type both(Type a, Type b) { return _mm256_and_si256(a, b); }
+    static ALWAYS_INLINE unsigned mask(Type v) { return static_cast<unsigned>(_mm256_movemask_epi8(v)); }
+    static const unsigned fullMask = 0xFFFFFFFFU;
+#else
+    typedef __m128i Type;
+    static const int length = 8;
+    static ALWAYS_INLINE Type load(const UChar* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static ALWAYS_INLINE Type splat(int c) { return _mm_set1_epi16(static_cast<short>(c)); }
+    static ALWAYS_INLINE Type equal(Type a, Type b) { return _mm_cmpeq_epi16(a, b); }
+    static ALWAYS_INLINE Type either(Type a, Type b) { return _mm_or_si128(a, b); }
+    static ALWAYS_INLINE Type both(Type a, Type b) { return _mm_and_si128(a, b); }
+    static ALWAYS_INLINE unsigned mask(Type v) { return static_cast<unsigned>(_mm_movemask_epi8(v)); }
+    static const unsigned fullMask = 0xFFFFU;
+#endif
+    // Every 16-bit lane contributes two bits to the mask.
+    static ALWAYS_INLINE unsigned index(unsigned mask) { return countTrailingZeros(mask) / 2; }
+
+    static ALWAYS_INLINE Type lineOrParagraphSeparator(Type v) { return equal(both(v, splat(0xFFFE)), splat(0x2028)); }
+};
+#endif // CPU(X86_SSE2) || CPU(X86_AVX2)
+
+template <typename T>
+static ALWAYS_INLINE bool isLineTerminatorCharacter(T c)
+{
+    return c == '\n' || c == '\r' || (sizeof(T) > 1 && (c & ~1) == 0x2028);
+}
+
+// Finds the end of a single-line comment.
+template <typename T>
+static ALWAYS_INLINE const T* findLineTerminator(const T* start, const T* end)
+{
+#if ENABLE_SIMD_SCANNERS
+    typedef CharacterVector<T> V;
+    const typename V::Type newline = V::splat('\n');
+    const typename V::Type carriageReturn = V::splat('\r');
+    while (end - start >= V::length) {
+        typename V::Type v = V::load(start);
+        unsigned mask = V::mask(V::either(V::either(V::equal(v, newline), V::equal(v, carriageReturn)), V::lineOrParagraphSeparator(v)));
+        if (mask)
+            return start + V::index(mask);
+        start += V::length;
+    }
+#endif
+    while (start < end && !isLineTerminatorCharacter(*start))
+        ++start;
+    return start;
+}
+
+// Finds the next '*' or line terminator inside a multi-line comment.
+template <typename T>
+static ALWAYS_INLINE const T* findStarOrLineTerminator(const T* start, const T* end)
+{
+#if ENABLE_SIMD_SCANNERS
+    typedef CharacterVector<T> V;
+    const typename V::Type star = V::splat('*');
+    const typename V::Type newline = V::splat('\n');
+    const typename V::Type carriageReturn = V::splat('\r');
+    while (end - start >= V::length) {
+        typename V::Type v = V::load(start);
+        typename V::Type matches = V::either(V::equal(v, star), V::either(V::equal(v, newline), V::equal(v, carriageReturn)));
+        unsigned mask = V::mask(V::either(matches, V::lineOrParagraphSeparator(v)));
+        if (mask)
+            return start + V::index(mask);
+        start += V::length;
+    }
+#endif
+    while (start < end && *start != '*' && !isLineTerminatorCharacter(*start))
+        ++start;
+    return start;
+}
+
+// Finds the closing quote, a backslash or a line terminator inside a string literal.
+template <typename T>
+static ALWAYS_INLINE const T* findStringSpecial(const T* start, const T* end, T quote)
+{
+#if ENABLE_SIMD_SCANNERS
+    typedef CharacterVector<T> V;
+    const typename V::Type quoteVector = V::splat(quote);
+    const typename V::Type backslash = V::splat('\\');
+    const typename V::Type newline = V::splat('\n');
+    const typename V::Type carriageReturn = V::splat('\r');
+    while (end - start >= V::length) {
+        typename V::Type v = V::load(start);
+        typename V::Type matches = V::either(V::equal(v, quoteVector), V::equal(v, backslash));
+        matches = V::either(matches, V::either(V::equal(v, newline), V::equal(v, carriageReturn)));
+        unsigned mask = V::mask(V::either(matches, V::lineOrParagraphSeparator(v)));
+        if (mask)
+            return start + V::index(mask);
+        start += V::length;
+    }
+#endif
+    while (start < end && *start != quote && *start != '\\' && !isLineTerminatorCharacter(*start))
+        ++start;
+    return start;
+}
+
+// Skips a run of spaces and tabs, the bulk of indentation.
+template <typename T>
+static ALWAYS_INLINE const T* skipSpacesAndTabs(const T* start, const T* end)
+{
+#if ENABLE_SIMD_SCANNERS
+    typedef CharacterVector<T> V;
+    const typename V::Type space = V::splat(' ');
+    const typename V::Type tab = V::splat('\t');
+    while (end - start >= V::length) {
+        typename V::Type v = V::load(start);
+        unsigned mask = ~V::mask(V::either(V::equal(v, space), V::equal(v, tab))) & V::fullMask;
+        if (mask)
+            return start + V::index(mask);
+        start += V::length;
+    }
+#endif
+    while (start < end && (*start == ' ' || *start == '\t'))
+        ++start;
+    return start;
+}
+
+} // namespace JSC
+
+#endif // CharacterScanner_h
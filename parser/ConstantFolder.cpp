@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "ConstantFolder.h"
+
+#include "JSGlobalObjectFunctions.h"
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+using SyntaxTree::Node;
+
+static bool isLiteral(const Node* n)
+{
+    if (!n)
+        return false;
+    switch (n->type()) {
+    case Node::BooleanExpressionType:
+    case Node::NullType:
+    case Node::NumberExpressionType:
+    case Node::StringExpressionType:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static double toNumber(const Node* n)
+{
+    switch (n->type()) {
+    case Node::BooleanExpressionType:
+        return n->boolean() ? 1 : 0;
+    case Node::NumberExpressionType:
+        return n->number();
+    case Node::StringExpressionType:
+        return jsToNumber(n->string());
+    default:
+        return 0;
+    }
+}
+
+static UString toString(const Node* n)
+{
+    switch (n->type()) {
+    case Node::BooleanExpressionType:
+        return n->boolean() ? "true" : "false";
+    case Node::NumberExpressionType:
+        return UString::number(n->number());
+    case Node::StringExpressionType:
+        return n->string();
+    default:
+        return "null";
+    }
+}
+
+static bool toBoolean(const Node* n)
+{
+    switch (n->type()) {
+    case Node::BooleanExpressionType:
+        return n->boolean();
+    case Node::NumberExpressionType:
+        return n->number() && !std::isnan(n->number());
+    case Node::StringExpressionType:
+        return !n->string().isEmpty();
+    default:
+        return false;
+    }
+}
+
+static const char* typeOf(const Node* n)
+{
+    switch (n->type()) {
+    case Node::BooleanExpressionType:
+        return "boolean";
+    case Node::NumberExpressionType:
+        return "number";
+    case Node::StringExpressionType:
+        return "string";
+    default:
+        return "object";
+    }
+}
+
+// ECMA-262 9.5 and 9.6
+static uint32_t toUInt32(double d)
+{
+    if (std::isnan(d) || std::isinf(d))
+        return 0;
+    double truncated = d < 0 ? ceil(d) : floor(d);
+    double modulo = fmod(truncated, 4294967296.0);
+    if (modulo < 0)
+        modulo += 4294967296.0;
+    return static_cast<uint32_t>(modulo);
+}
+
+static int32_t toInt32(double d)
+{
+    return static_cast<int32_t>(toUInt32(d));
+}
+
+static int compareStrings(const UString& a, const UString& b)
+{
+    unsigned length = std::min(a.length(), b.length());
+    for (unsigned i = 0; i < length; ++i) {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    if (a.length() == b.length())
+        return 0;
+    return a.length() < b.length() ? -1 : 1;
+}
+
+
+// ECMA-262 11.9.3, restricted to the primitive literal types.
+static bool looselyEqual(const Node* a, const Node* b)
+{
+    if (a->type() == Node::NullType || b->type() == Node::NullType)
+        return a->type() == b->type();
+    if (a->type() == Node::StringExpressionType && b->type() == Node::StringExpressionType)
+        return a->string() == b->string();
+    return toNumber(a) == toNumber(b);
+}
+
+// ECMA-262 11.9.6
+static bool strictlyEqual(const Node* a, const Node* b)
+{
+    if (a->type() != b->type())
+        return false;
+    switch (a->type()) {
+    case Node::BooleanExpressionType:
+        return a->boolean() == b->boolean();
+    case Node::NumberExpressionType:
+        return a->number() == b->number();
+    case Node::StringExpressionType:
+        return a->string() == b->string();
+    default:
+        return true;
+    }
+}
+
+// ECMA-262 11.8.5. Returns false for comparisons involving NaN, which is
+// what all four relational operators produce in that case.
+static bool lessThan(const Node* a, const Node* b, bool& undefinedResult)
+{
+    undefinedResult = false;
+    if (a->type() == Node::StringExpressionType && b->type() == Node::StringExpressionType)
+        return compareStrings(a->string(), b->string()) < 0;
+    double x = toNumber(a);
+    double y = toNumber(b);
+    if (std::isnan(x) || std::isnan(y)) {
+        undefinedResult = true;
+        return false;
+    }
+    return x < y;
+}
+
+static bool hasLiteralForm(double d)
+{
+    return !std::isnan(d) && !std::isinf(d) && !(d == 0 && std::signbit(d));
+}
+
+static void foldToNumber(Node* n, double d)
+{
+    if (hasLiteralForm(d))
+        n->becomeNumber(d);
+}
+
+ConstantFolder::ConstantFolder(JSGlobalData* globalData, IdentifierArena& identifiers)
+    : m_globalData(globalData)
+    , m_identifiers(identifiers)
+{
+}
+
+const Identifier& ConstantFolder::makeString(const char* characters)
+{
+    return m_identifiers.makeIdentifier(m_globalData, reinterpret_cast<const LChar*>(characters), strlen(characters));
+}
+
+const Identifier& ConstantFolder::concatenate(const UString& a, const UString& b)
+{
+    Vector<UChar, 64> buffer;
+    buffer.append(a.characters(), a.length());
+    buffer.append(b.characters(), b.length());
+    return m_identifiers.makeIdentifier(m_globalData, buffer.data(), buffer.size());
+}
+
+void ConstantFolder::process(Node* n)
+{
+    for (int i = 0; i < n->childCount(); ++i) {
+        if (Node* child = n->childAt(i))
+            child->apply(this);
+    }
+
+    switch (n->type()) {
+    case Node::UnaryExpressionType:
+        foldUnary(n);
+        break;
+    case Node::BinaryExpressionType:
+        foldBinary(n);
+        break;
+    case Node::ConditionalExpressionType:
+        foldConditional(n);
+        break;
+    default:
+        break;
+    }
+}
+
+void ConstantFolder::foldUnary(Node* n)
+{
+    if (n->childCount() != 1 || !isLiteral(n->childAt(0)))
+        return;
+    const Node* operand = n->childAt(0);
+
+    switch (n->op()) {
+    case Node::TypeofOperator:
+        n->becomeString(makeString(typeOf(operand)));
+        break;
+    case Node::DeleteOperator:
+        // Deleting anything that is not a reference yields true.
+        n->becomeBoolean(true);
+        break;
+    case Node::LogicalNotOperator:
+        n->becomeBoolean(!toBoolean(operand));
+        break;
+    case Node::BitwiseNotOperator:
+        n->becomeNumber(~toInt32(toNumber(operand)));
+        break;
+    case Node::SubtractOperator:
+        foldToNumber(n, -toNumber(operand));
+        break;
+    case Node::AddOperator:
+        foldToNumber(n, toNumber(operand));
+        break;
+    default:
+        break;
+    }
+}
+
+void ConstantFolder::foldBinary(Node* n)
+{
+    if (n->childCount() != 2)
+        return;
+    Node* lhs = n->childAt(0);
+    Node* rhs = n->childAt(1);
+
+    // The logical operators yield one of their operands, so only the left
+    // one has to be a literal.
+    if (n->op() == Node::LogicalAndOperator || n->op() == Node::LogicalOrOperator) {
+        if (!isLiteral(lhs) || !rhs)
+            return;
+        bool takeLeft = toBoolean(lhs) == (n->op() == Node::LogicalOrOperator);
+        n->replaceWith(takeLeft ? lhs : rhs);
+        return;
+    }
+
+    if (!isLiteral(lhs) || !isLiteral(rhs))
+        return;
+
+    bool undefinedResult;
+    switch (n->op()) {
+    case Node::AddOperator:
+        if (lhs->type() == Node::StringExpressionType || rhs->type() == Node::StringExpressionType)
+            n->becomeString(concatenate(toString(lhs), toString(rhs)));
+        else
+            foldToNumber(n, toNumber(lhs) + toNumber(rhs));
+        break;
+    case Node::SubtractOperator:
+        foldToNumber(n, toNumber(lhs) - toNumber(rhs));
+        break;
+    case Node::MultiplyOperator:
+        foldToNumber(n, toNumber(lhs) * toNumber(rhs));
+        break;
+    case Node::DivideOperator:
+        foldToNumber(n, toNumber(lhs) / toNumber(rhs));
+        break;
+    case Node::ModulusOperator:
+        foldToNumber(n, fmod(toNumber(lhs), toNumber(rhs)));
+        break;
+    case Node::LeftShiftOperator:
+        n->becomeNumber(static_cast<int32_t>(toUInt32(toNumber(lhs)) << (toUInt32(toNumber(rhs)) & 0x1f)));
+        break;
+    case Node::RightShiftOperator:
+        n->becomeNumber(toInt32(toNumber(lhs)) >> (toUInt32(toNumber(rhs)) & 0x1f));
+        break;
+    case Node::ZeroFillRightShiftOperator:
+        n->becomeNumber(toUInt32(toNumber(lhs)) >> (toUInt32(toNumber(rhs)) & 0x1f));
+        break;
+    case Node::BitwiseAndOperator:
+        n->becomeNumber(toInt32(toNumber(lhs)) & toInt32(toNumber(rhs)));
+        break;
+    case Node::BitwiseOrOperator:
+        n->becomeNumber(toInt32(toNumber(lhs)) | toInt32(toNumber(rhs)));
+        break;
+    case Node::BitwiseXorOperator:
+        n->becomeNumber(toInt32(toNumber(lhs)) ^ toInt32(toNumber(rhs)));
+        break;
+    case Node::EqualOperator:
+        n->becomeBoolean(looselyEqual(lhs, rhs));
+        break;
+    case Node::NotEqualOperator:
+        n->becomeBoolean(!looselyEqual(lhs, rhs));
+        break;
+    case Node::StringEqualOperator:
+        n->becomeBoolean(strictlyEqual(lhs, rhs));
+        break;
+    case Node::StringNotEqualOperator:
+        n->becomeBoolean(!strictlyEqual(lhs, rhs));
+        break;
+    case Node::LessThanOperator:
+        n->becomeBoolean(lessThan(lhs, rhs, undefinedResult));
+        break;
+    case Node::GreaterThanOperator:
+        n->becomeBoolean(lessThan(rhs, lhs, undefinedResult));
+        break;
+    case Node::LessThanOrEqualOperator: {
+        bool greater = lessThan(rhs, lhs, undefinedResult);
+        n->becomeBoolean(!undefinedResult && !greater);
+        break;
+    }
+    case Node::GreaterThanOrEqualOperator: {
+        bool less = lessThan(lhs, rhs, undefinedResult);
+        n->becomeBoolean(!undefinedResult && !less);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void ConstantFolder::foldConditional(Node* n)
+{
+    if (n->childCount() != 3 || !isLiteral(n->childAt(0)))
+        return;
+    Node* branch = n->childAt(toBoolean(n->childAt(0)) ? 1 : 2);
+    if (branch)
+        n->replaceWith(branch);
+}
+
+} // namespace JSC
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ConstantFolder_h
+#define ConstantFolder_h
+
+#include <SyntaxTree.h>
+
+namespace JSC {
+
+// Folds unary, binary and conditional expressions whose operands are
+// literals, rewriting the nodes in place, bottom-up. Conversions follow the
+// ECMAScript rules (ToNumber, ToString, ToInt32, the equality and relational
+// comparisons). Operators that could observe anything but the literal values,
+// such as 'in' and 'instanceof', are left alone, as are folds that would
+// produce NaN, an infinity or negative zero, since those have no literal form.
+// Folded strings are interned in the given arena, like string literals.
+class ConstantFolder : public SyntaxTree::Visitor
+{
+public:
+    ConstantFolder(JSGlobalData*, IdentifierArena&);
+
+    virtual void process(SyntaxTree::Node*);
+
+private:
+    const Identifier& makeString(const char*);
+    const Identifier& concatenate(const UString&, const UString&);
+
+    void foldUnary(SyntaxTree::Node*);
+    void foldBinary(SyntaxTree::Node*);
+    void foldConditional(SyntaxTree::Node*);
+
+    JSGlobalData* m_globalData;
+    IdentifierArena& m_identifiers;
+};
+
+} // namespace JSC
+
+#endif // ConstantFolder_h
@@ -31,18 +31,19 @@ using namespace JSC;
 
 #include "Identifier.h"
 #include "JSGlobalData.h"
+#include "ParserProfiler.h"
 #include "SyntaxTree.h"
-#include "TreeDumper.h"
 #include <utility>
 
 using namespace std;
 
 namespace JSC {
-#define fail() do { m_error = true; return 0; } while (0)
+#define fail() do { setError(); return 0; } while (0)
+#define failExpecting(tokenType) do { setError(tokenType); return 0; } while (0)
 #define failIfFalse(cond) do { if (!(cond)) fail(); } while (0)
 #define failIfTrue(cond) do { if ((cond)) fail(); } while (0)
-#define consumeOrFail(tokenType) do { if (!consume(tokenType)) fail(); } while (0)
-#define matchOrFail(tokenType) do { if (!match(tokenType)) fail(); } while (0)
+#define consumeOrFail(tokenType) do { if (!consume(tokenType)) failExpecting(tokenType); } while (0)
+#define matchOrFail(tokenType) do { if (!match(tokenType)) failExpecting(tokenType); } while (0)
 #define failIfStackOverflow() do { failIfFalse(canRecurse()); } while (0)
 
 // Macros to make the more common TreeBuilder types a little less verbose
@@ -64,10 +65,12 @@ COMPILE_ASSERT(LastUntaggedToken < 64, LessThan64UntaggedTokens);
 // This matches v8
 static const ptrdiff_t kMaxParserStackUsage = 128 * sizeof(void*) * 1024;
 
+template <typename LexerType>
 class JSParser {
 public:
-    JSParser(Lexer*, JSGlobalData*, SourceProvider*);
-    UString createSyntaxTree();
+    JSParser(LexerType*, JSGlobalData*, SourceProvider*, ParserArena&, FunctionBodyMode, Vector<ParseDiagnostic>* = 0);
+    SyntaxTree::Node* parseProgram();
+    SyntaxTree::Node* parseStandaloneFunctionBody();
 private:
     struct AllowInOverride {
         AllowInOverride(JSParser* parser)
@@ -84,23 +87,38 @@ private:
         bool m_oldAllowsIn;
     };
 
-    void next(Lexer::LexType lexType = Lexer::IdentifyReservedWords)
+    void next(typename LexerType::LexType lexType = LexerType::IdentifyReservedWords)
     {
         m_lastLine = m_token.m_info.line;
         m_lastTokenEnd = m_token.m_info.endOffset;
         m_lexer->setLastLineNumber(m_lastLine);
+#if ENABLE(PARSER_PROFILING)
+        uint64_t lexStart = ParserProfiler::now();
         m_token.m_type = m_lexer->lex(&m_token.m_data, &m_token.m_info, lexType);
+        ParserProfiler::recordToken(m_token.m_type, ParserProfiler::now() - lexStart);
+#else
+        m_token.m_type = m_lexer->lex(&m_token.m_data, &m_token.m_info, lexType);
+#endif
         m_tokenCount++;
+        if (m_token.m_type == OPENBRACE)
+            m_braceDepth++;
+        else if (m_token.m_type == CLOSEBRACE)
+            m_braceDepth--;
     }
 
     bool consume(JSTokenType expected)
     {
         bool result = m_token.m_type == expected;
-        failIfFalse(result);
-        next();
+        if (result)
+            next();
         return result;
     }
 
+    // Only the first error of a statement is reported; the failures of the
+    // enclosing rules follow from it.
+    NEVER_INLINE void setError(JSTokenType expected = ERRORTOK);
+    void skipFailedStatement(int braceDepth);
+
     bool match(JSTokenType expected)
     {
         return m_token.m_type == expected;
@@ -183,8 +201,8 @@ private:
         return m_lastTokenEnd;
     }
 
-    ParserArena m_arena;
-    Lexer* m_lexer;
+    ParserArena& m_arena;
+    LexerType* m_lexer;
     bool m_error;
     JSGlobalData* m_globalData;
     JSToken m_token;
@@ -195,16 +213,36 @@ private:
     int m_assignmentCount;
     int m_nonLHSCount;
     bool m_syntaxAlreadyValidated;
+    FunctionBodyMode m_functionBodyMode;
+    const Identifier* m_argumentsIdentifier;
+    // Opening braces minus closing braces up to and including the current token.
+    int m_braceDepth;
+    Vector<ParseDiagnostic>* m_diagnostics;
 };
 
-UString jsCreateSyntaxTree(JSGlobalData* globalData, const SourceCode* source)
+template <typename LexerType>
+SyntaxTree::Node* jsParse(JSGlobalData* globalData, LexerType* lexer, const SourceCode* source, ParserArena& arena, FunctionBodyMode functionBodyMode, Vector<ParseDiagnostic>* diagnostics)
 {
-    JSParser parser(globalData->lexer, globalData, source->provider());
-    return parser.createSyntaxTree();
+    JSParser<LexerType> parser(lexer, globalData, source->provider(), arena, functionBodyMode, diagnostics);
+    return parser.parseProgram();
 }
 
-JSParser::JSParser(Lexer* lexer, JSGlobalData* globalData, SourceProvider* provider)
-    : m_lexer(lexer)
+template <typename LexerType>
+SyntaxTree::Node* jsParseFunctionBody(JSGlobalData* globalData, LexerType* lexer, const SourceCode* source, ParserArena& arena, FunctionBodyMode functionBodyMode)
+{
+    JSParser<LexerType> parser(lexer, globalData, source->provider(), arena, functionBodyMode);
+    return parser.parseStandaloneFunctionBody();
+}
+
+template SyntaxTree::Node* jsParse(JSGlobalData*, Lexer<LChar>*, const SourceCode*, ParserArena&, FunctionBodyMode, Vector<ParseDiagnostic>*);
+template SyntaxTree::Node* jsParse(JSGlobalData*, Lexer<UChar>*, const SourceCode*, ParserArena&, FunctionBodyMode, Vector<ParseDiagnostic>*);
+template SyntaxTree::Node* jsParseFunctionBody(JSGlobalData*, Lexer<LChar>*, const SourceCode*, ParserArena&, FunctionBodyMode);
+template SyntaxTree::Node* jsParseFunctionBody(JSGlobalData*, Lexer<UChar>*, const SourceCode*, ParserArena&, FunctionBodyMode);
+
+template <typename LexerType>
+JSParser<LexerType>::JSParser(LexerType* lexer, JSGlobalData* globalData, SourceProvider* provider, ParserArena& arena, FunctionBodyMode functionBodyMode, Vector<ParseDiagnostic>* diagnostics)
+    : m_arena(arena)
+    , m_lexer(lexer)
     , m_error(false)
     , m_globalData(globalData)
     , m_allowsIn(true)
@@ -214,45 +252,151 @@ JSParser::JSParser(Lexer* lexer, JSGlobalData* globalData, SourceProvider* provi
     , m_assignmentCount(0)
     , m_nonLHSCount(0)
     , m_syntaxAlreadyValidated(provider->isValid())
+    , m_functionBodyMode(functionBodyMode)
+    , m_braceDepth(0)
+    , m_diagnostics(diagnostics)
 {
+    // The lexer interns names in this arena, so "arguments" can be recognized by address.
+    const Identifier& arguments = globalData->propertyNames->arguments;
+    m_argumentsIdentifier = &m_arena.identifierArena().makeIdentifier(globalData, arguments.characters(), arguments.length());
     next();
     m_lexer->setLastLineNumber(tokenLine());
 }
 
-UString JSParser::createSyntaxTree()
+template <typename LexerType>
+SyntaxTree::Node* JSParser<LexerType>::parseProgram()
 {
-    SyntaxTree::Builder context(m_globalData, m_lexer);
-    SyntaxTree::Node* programNode = parseSourceElements<SyntaxTree::Builder>(context);
-    if (programNode) {
-        JSONTreeDumper dumper;
-        dumper.start();
-        programNode->apply(&dumper);
-        dumper.finish();
-        return dumper.result();
-    } else {
-        return UString();
-        CRASH();
+    PROFILE_PRODUCTION(Program);
+    SyntaxTree::Builder context(m_globalData, m_arena, m_argumentsIdentifier);
+    SyntaxTree::Node* sourceElements = parseSourceElements<SyntaxTree::Builder>(context);
+
+    // Outside of any block, a closing brace, case or default stops the source
+    // elements early. When recovering, report it and go on after it.
+    while (m_diagnostics && !match(EOFTOK)) {
+        ASSERT(sourceElements);
+        setError();
+        m_error = false;
+        if (m_lexer->sawError())
+            m_lexer->recoverFromError();
+        next();
+        SyntaxTree::Node* rest = parseSourceElements<SyntaxTree::Builder>(context);
+        for (int i = 0; i < rest->childCount(); ++i)
+            context.appendStatement(sourceElements, rest->childAt(i));
+    }
+    if (sourceElements)
+        context.closeProgramScope(sourceElements);
+    return sourceElements;
+}
+
+template <typename LexerType>
+SyntaxTree::Node* JSParser<LexerType>::parseStandaloneFunctionBody()
+{
+    PROFILE_PRODUCTION(StandaloneFunctionBody);
+    SyntaxTree::Builder context(m_globalData, m_arena, m_argumentsIdentifier);
+    matchOrFail(OPENBRACE);
+    int openBracePos = m_token.m_data.intValue;
+    next();
+
+    SyntaxTree::Node* body = parseFunctionBody(context);
+    failIfFalse(body);
+
+    matchOrFail(CLOSEBRACE);
+    context.setRange(body, openBracePos, m_token.m_data.intValue + 1);
+    next();
+    matchOrFail(EOFTOK);
+    return body;
+}
+
+template <typename LexerType>
+void JSParser<LexerType>::setError(JSTokenType expected)
+{
+    if (m_error)
+        return;
+    m_error = true;
+    if (!m_diagnostics)
+        return;
+
+    // The lexer leaves no position for the end of input or for a token it
+    // could not make, but it stopped there.
+    int offset = tokenStart();
+    int line = tokenLine();
+    if (match(EOFTOK) || match(ERRORTOK)) {
+        offset = m_lexer->currentOffset();
+        line = m_lexer->lineNumber();
+    }
+
+    // Skipping a failed statement may stop at the token that failed it, which
+    // then fails the enclosing rule.
+    if (!m_diagnostics->isEmpty() && m_diagnostics->last().offset == offset)
+        return;
+    m_diagnostics->append(ParseDiagnostic(offset, line, m_token.m_type, expected));
+}
+
+// Skips the rest of a statement that failed to parse: past a semicolon, or
+// a closing brace that ends a line, at the nesting the statement started at;
+// or to the brace that closes the enclosing block, a case or default, or the
+// end of input. A lexer error skips the rest of its line, which ends the
+// statement unless it is inside braces.
+template <typename LexerType>
+void JSParser<LexerType>::skipFailedStatement(int braceDepth)
+{
+    while (true) {
+        if (m_lexer->sawError() || match(ERRORTOK)) {
+            bool atStatementDepth = m_braceDepth <= braceDepth;
+            m_lexer->recoverFromError();
+            next();
+            if (atStatementDepth)
+                return;
+            continue;
+        }
+        if (match(EOFTOK) || (match(CLOSEBRACE) && m_braceDepth < braceDepth))
+            return;
+        if ((match(CASE) || match(DEFAULT)) && m_braceDepth == braceDepth)
+            return;
+
+        bool atSemicolon = match(SEMICOLON) && m_braceDepth == braceDepth;
+        bool atCloseBrace = match(CLOSEBRACE) && m_braceDepth == braceDepth;
+        next();
+        if (atSemicolon || (atCloseBrace && m_lexer->prevTerminator()))
+            return;
     }
 }
 
-bool JSParser::allowAutomaticSemicolon()
+template <typename LexerType>
+bool JSParser<LexerType>::allowAutomaticSemicolon()
 {
     return match(CLOSEBRACE) || match(EOFTOK) || m_lexer->prevTerminator();
 }
 
-template <class TreeBuilder> TreeSourceElements JSParser::parseSourceElements(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeSourceElements JSParser<LexerType>::parseSourceElements(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(SourceElements);
     TreeSourceElements sourceElements = context.createSourceElements();
-    while (TreeStatement statement = parseStatement(context))
-        context.appendStatement(sourceElements, statement);
+    while (true) {
+        int braceDepth = m_braceDepth - match(OPENBRACE);
+        TreeStatement statement = parseStatement(context);
+        if (statement) {
+            context.appendStatement(sourceElements, statement);
+            continue;
+        }
+        if (!m_error || !m_diagnostics)
+            break;
+
+        // Leave the failed statement out and go on with the next one.
+        skipFailedStatement(braceDepth);
+        m_error = false;
+    }
 
     if (m_error)
         fail();
     return sourceElements;
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseVarDeclaration(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseVarDeclaration(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(VarDeclaration);
     ASSERT(match(VAR));
     int start = tokenLine();
     int end = 0;
@@ -268,8 +412,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseVarDeclaration(TreeBui
     return context.createVarStatement(varDecls, start, end);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseConstDeclaration(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseConstDeclaration(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ConstDeclaration);
     ASSERT(match(CONSTTOKEN));
     int start = tokenLine();
     int end = 0;
@@ -280,8 +426,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseConstDeclaration(TreeB
     return context.createConstStatement(constDecls, start, end);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseDoWhileStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseDoWhileStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(DoWhileStatement);
     ASSERT(match(DO));
     int startLine = tokenLine();
     next();
@@ -298,8 +446,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseDoWhileStatement(TreeB
     return context.createDoWhileStatement(statement, expr, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseWhileStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseWhileStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(WhileStatement);
     ASSERT(match(WHILE));
     int startLine = tokenLine();
     next();
@@ -313,8 +463,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseWhileStatement(TreeBui
     return context.createWhileStatement(expr, statement, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseVarDeclarationList(TreeBuilder& context, int& declarations, const Identifier*& lastIdent, TreeExpression& lastInitializer, int& identStart, int& initStart, int& initEnd)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseVarDeclarationList(TreeBuilder& context, int& declarations, const Identifier*& lastIdent, TreeExpression& lastInitializer, int& identStart, int& initStart, int& initEnd)
 {
+    PROFILE_PRODUCTION(VarDeclarationList);
     TreeExpression varDecls = 0;
     do {
         declarations++;
@@ -355,8 +507,10 @@ template <class TreeBuilder> TreeExpression JSParser::parseVarDeclarationList(Tr
     return varDecls;
 }
 
-template <class TreeBuilder> TreeConstDeclList JSParser::parseConstDeclarationList(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeConstDeclList JSParser<LexerType>::parseConstDeclarationList(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ConstDeclarationList);
     TreeConstDeclList constDecls = 0;
     TreeConstDeclList tail = 0;
     do {
@@ -378,8 +532,10 @@ template <class TreeBuilder> TreeConstDeclList JSParser::parseConstDeclarationLi
     return constDecls;
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseForStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseForStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ForStatement);
     ASSERT(match(FOR));
     int startLine = tokenLine();
     next();
@@ -413,8 +569,7 @@ template <class TreeBuilder> TreeStatement JSParser::parseForStatement(TreeBuild
 
         // Handle for-in with var declaration
         int inLocation = tokenStart();
-        if (!consume(INTOKEN))
-            fail();
+        consumeOrFail(INTOKEN);
 
         TreeExpression expr = parseExpression(context);
         failIfFalse(expr);
@@ -440,8 +595,9 @@ template <class TreeBuilder> TreeStatement JSParser::parseForStatement(TreeBuild
 
     if (match(SEMICOLON)) {
     standardForLoop:
-        // Standard for loop
-        next();
+        // Standard for loop. A list of several declarations jumps here
+        // whatever token follows it.
+        consumeOrFail(SEMICOLON);
         TreeExpression condition = 0;
 
         if (!match(SEMICOLON)) {
@@ -476,8 +632,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseForStatement(TreeBuild
     return context.createForInLoop(decls, expr, statement, declsStart, declsEnd, exprEnd, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseBreakStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseBreakStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(BreakStatement);
     ASSERT(match(BREAK));
     int startCol = tokenStart();
     int endCol = tokenEnd();
@@ -496,8 +654,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseBreakStatement(TreeBui
     return context.createBreakStatement(ident, startCol, endCol, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseContinueStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseContinueStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ContinueStatement);
     ASSERT(match(CONTINUE));
     int startCol = tokenStart();
     int endCol = tokenEnd();
@@ -516,8 +676,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseContinueStatement(Tree
     return context.createContinueStatement(ident, startCol, endCol, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseReturnStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseReturnStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ReturnStatement);
     ASSERT(match(RETURN));
     int startLine = tokenLine();
     int endLine = startLine;
@@ -540,8 +702,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseReturnStatement(TreeBu
     return context.createReturnStatement(expr, start, end, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseThrowStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseThrowStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ThrowStatement);
     ASSERT(match(THROW));
     int eStart = tokenStart();
     int startLine = tokenLine();
@@ -556,8 +720,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseThrowStatement(TreeBui
     return context.createThrowStatement(expr, eStart, eEnd, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseWithStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseWithStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(WithStatement);
     ASSERT(match(WITH));
     int startLine = tokenLine();
     next();
@@ -576,8 +742,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseWithStatement(TreeBuil
     return context.createWithStatement(expr, statement, start, end, startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseSwitchStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseSwitchStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(SwitchStatement);
     ASSERT(match(SWITCH));
     int startLine = tokenLine();
     next();
@@ -602,8 +770,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseSwitchStatement(TreeBu
 
 }
 
-template <class TreeBuilder> TreeClauseList JSParser::parseSwitchClauses(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeClauseList JSParser<LexerType>::parseSwitchClauses(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(SwitchClauses);
     if (!match(CASE))
         return 0;
     next();
@@ -629,8 +799,10 @@ template <class TreeBuilder> TreeClauseList JSParser::parseSwitchClauses(TreeBui
     return clauseList;
 }
 
-template <class TreeBuilder> TreeClause JSParser::parseSwitchDefaultClause(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeClause JSParser<LexerType>::parseSwitchDefaultClause(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(SwitchDefaultClause);
     if (!match(DEFAULT))
         return 0;
     next();
@@ -640,8 +812,10 @@ template <class TreeBuilder> TreeClause JSParser::parseSwitchDefaultClause(TreeB
     return context.createClause(0, statements);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseTryStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseTryStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(TryStatement);
     ASSERT(match(TRY));
     TreeStatement tryBlock = 0;
     const Identifier* ident = &m_globalData->propertyNames->nullIdentifier;
@@ -680,8 +854,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseTryStatement(TreeBuild
     return context.createTryStatement(tryBlock, ident, catchHasEval, catchBlock, finallyBlock, firstLine, lastLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseDebuggerStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseDebuggerStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(DebuggerStatement);
     ASSERT(match(DEBUGGER));
     int startLine = tokenLine();
     int endLine = startLine;
@@ -692,8 +868,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseDebuggerStatement(Tree
     return context.createDebugger(startLine, endLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseBlockStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseBlockStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(BlockStatement);
     ASSERT(match(OPENBRACE));
     int start = tokenLine();
     next();
@@ -708,45 +886,66 @@ template <class TreeBuilder> TreeStatement JSParser::parseBlockStatement(TreeBui
     return context.createBlockStatement(subtree, start, m_lastLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(Statement);
     failIfStackOverflow();
+    int start = tokenStart();
+    TreeStatement result = 0;
     switch (m_token.m_type) {
     case OPENBRACE:
-        return parseBlockStatement(context);
+        result = parseBlockStatement(context);
+        break;
     case VAR:
-        return parseVarDeclaration(context);
+        result = parseVarDeclaration(context);
+        break;
     case CONSTTOKEN:
-        return parseConstDeclaration(context);
+        result = parseConstDeclaration(context);
+        break;
     case FUNCTION:
-        return parseFunctionDeclaration(context);
+        result = parseFunctionDeclaration(context);
+        break;
     case SEMICOLON:
         next();
-        return context.createEmptyStatement();
+        result = context.createEmptyStatement();
+        break;
     case IF:
-        return parseIfStatement(context);
+        result = parseIfStatement(context);
+        break;
     case DO:
-        return parseDoWhileStatement(context);
+        result = parseDoWhileStatement(context);
+        break;
     case WHILE:
-        return parseWhileStatement(context);
+        result = parseWhileStatement(context);
+        break;
     case FOR:
-        return parseForStatement(context);
+        result = parseForStatement(context);
+        break;
     case CONTINUE:
-        return parseContinueStatement(context);
+        result = parseContinueStatement(context);
+        break;
     case BREAK:
-        return parseBreakStatement(context);
+        result = parseBreakStatement(context);
+        break;
     case RETURN:
-        return parseReturnStatement(context);
+        result = parseReturnStatement(context);
+        break;
     case WITH:
-        return parseWithStatement(context);
+        result = parseWithStatement(context);
+        break;
     case SWITCH:
-        return parseSwitchStatement(context);
+        result = parseSwitchStatement(context);
+        break;
     case THROW:
-        return parseThrowStatement(context);
+        result = parseThrowStatement(context);
+        break;
     case TRY:
-        return parseTryStatement(context);
+        result = parseTryStatement(context);
+        break;
     case DEBUGGER:
-        return parseDebuggerStatement(context);
+        result = parseDebuggerStatement(context);
+        break;
     case EOFTOK:
     case CASE:
     case CLOSEBRACE:
@@ -754,16 +953,23 @@ template <class TreeBuilder> TreeStatement JSParser::parseStatement(TreeBuilder&
         // These tokens imply the end of a set of source elements
         return 0;
     case IDENT:
-        return parseExpressionOrLabelStatement(context);
+        result = parseExpressionOrLabelStatement(context);
+        break;
     default:
-        return parseExpressionStatement(context);
+        result = parseExpressionStatement(context);
+        break;
     }
+    if (result)
+        context.setRange(result, start, lastTokenEnd());
+    return result;
 }
 
-template <class TreeBuilder> TreeFormalParameterList JSParser::parseFormalParameters(TreeBuilder& context, bool& usesArguments)
+template <typename LexerType>
+template <class TreeBuilder> TreeFormalParameterList JSParser<LexerType>::parseFormalParameters(TreeBuilder& context, bool& usesArguments)
 {
+    PROFILE_PRODUCTION(FormalParameters);
     matchOrFail(IDENT);
-    usesArguments = m_globalData->propertyNames->arguments == *m_token.m_data.ident;
+    usesArguments = m_token.m_data.ident == m_argumentsIdentifier;
     TreeFormalParameterList list = context.createFormalParameterList(*m_token.m_data.ident);
     TreeFormalParameterList tail = list;
     next();
@@ -772,24 +978,28 @@ template <class TreeBuilder> TreeFormalParameterList JSParser::parseFormalParame
         matchOrFail(IDENT);
         const Identifier* ident = m_token.m_data.ident;
         next();
-        usesArguments = usesArguments || m_globalData->propertyNames->arguments == *ident;
+        usesArguments = usesArguments || ident == m_argumentsIdentifier;
         tail = context.createFormalParameterList(tail, *ident);
     }
     return list;
 }
 
-template <class TreeBuilder> TreeFunctionBody JSParser::parseFunctionBody(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeFunctionBody JSParser<LexerType>::parseFunctionBody(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(FunctionBody);
+    typename TreeBuilder::FunctionBodyBuilder bodyBuilder(m_globalData, m_arena, m_argumentsIdentifier);
     if (match(CLOSEBRACE))
-        return context.createFunctionBody();
-    typename TreeBuilder::FunctionBodyBuilder bodyBuilder(m_globalData, m_lexer);
+        return bodyBuilder.createFunctionBody();
     typename TreeBuilder::SourceElements function = parseSourceElements(bodyBuilder);
     failIfFalse(function);
-    return context.createFunctionBody(function);
+    return bodyBuilder.createFunctionBody(function);
 }
 
-template <JSParser::FunctionRequirements requirements, class TreeBuilder> bool JSParser::parseFunctionInfo(TreeBuilder& context, const Identifier*& name, TreeFormalParameterList& parameters, TreeFunctionBody& body, int& openBracePos, int& closeBracePos, int& bodyStartLine)
+template <typename LexerType>
+template <typename JSParser<LexerType>::FunctionRequirements requirements, class TreeBuilder> bool JSParser<LexerType>::parseFunctionInfo(TreeBuilder& context, const Identifier*& name, TreeFormalParameterList& parameters, TreeFunctionBody& body, int& openBracePos, int& closeBracePos, int& bodyStartLine)
 {
+    PROFILE_PRODUCTION(FunctionInfo);
     if (match(IDENT)) {
         name = m_token.m_data.ident;
         next();
@@ -806,21 +1016,34 @@ template <JSParser::FunctionRequirements requirements, class TreeBuilder> bool J
 
     openBracePos = m_token.m_data.intValue;
     bodyStartLine = tokenLine();
-    next();
 
-    body = parseFunctionBody(context);
-    failIfFalse(body);
+    LexerState afterOpenBrace = m_lexer->state();
+    if (m_functionBodyMode == SkipFunctionBodies && m_lexer->skipFunctionBody()) {
+        next();
+        body = context.createUnparsedFunctionBody();
+    } else {
+        // A body the skip could not pair up is parsed now, which also reports
+        // its error if it has one.
+        if (m_functionBodyMode == SkipFunctionBodies)
+            m_lexer->restoreState(afterOpenBrace);
+        next();
+        body = parseFunctionBody(context);
+        failIfFalse(body);
+    }
     if (usesArguments)
         context.setUsesArguments(body);
 
     matchOrFail(CLOSEBRACE);
     closeBracePos = m_token.m_data.intValue;
+    context.setRange(body, openBracePos, closeBracePos + 1);
     next();
     return true;
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseFunctionDeclaration(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseFunctionDeclaration(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(FunctionDeclaration);
     ASSERT(match(FUNCTION));
     next();
     const Identifier* name = 0;
@@ -834,8 +1057,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseFunctionDeclaration(Tr
     return context.createFuncDeclStatement(name, body, parameters, openBracePos, closeBracePos, bodyStartLine, m_lastLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseExpressionOrLabelStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseExpressionOrLabelStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ExpressionOrLabelStatement);
 
     /* Expression and Label statements are ambiguous at LL(1), to avoid
      * the cost of having a token buffer to support LL(2) we simply assume
@@ -858,8 +1083,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseExpressionOrLabelState
     return context.createLabelStatement(ident, statement, start, end);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseExpressionStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseExpressionStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ExpressionStatement);
     int startLine = tokenLine();
     TreeExpression expression = parseExpression(context);
     failIfFalse(expression);
@@ -867,8 +1094,10 @@ template <class TreeBuilder> TreeStatement JSParser::parseExpressionStatement(Tr
     return context.createExprStatement(expression, startLine, m_lastLine);
 }
 
-template <class TreeBuilder> TreeStatement JSParser::parseIfStatement(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeStatement JSParser<LexerType>::parseIfStatement(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(IfStatement);
     ASSERT(match(IF));
 
     int start = tokenLine();
@@ -887,9 +1116,9 @@ template <class TreeBuilder> TreeStatement JSParser::parseIfStatement(TreeBuilde
     if (!match(ELSE))
         return context.createIfStatement(condition, trueBlock, start, end);
     
-    Vector<TreeExpression> exprStack;
-    Vector<pair<int, int> > posStack;
-    Vector<TreeStatement> statementStack;
+    Vector<TreeExpression, 16> exprStack;
+    Vector<pair<int, int>, 16> posStack;
+    Vector<TreeStatement, 16> statementStack;
     bool trailingElse = false;
     do {
         next();
@@ -942,9 +1171,12 @@ template <class TreeBuilder> TreeStatement JSParser::parseIfStatement(TreeBuilde
     return context.createIfStatement(condition, trueBlock, statementStack.last(), start, end);
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(Expression);
     failIfStackOverflow();
+    int start = tokenStart();
     TreeExpression node = parseAssignmentExpression(context);
     failIfFalse(node);
     if (!match(COMMA))
@@ -960,12 +1192,15 @@ template <class TreeBuilder> TreeExpression JSParser::parseExpression(TreeBuilde
         failIfFalse(right);
         context.appendToComma(commaNode, right);
     }
+    context.setRange(commaNode, start, lastTokenEnd());
     return commaNode;
 }
 
 
-template <typename TreeBuilder> TreeExpression JSParser::parseAssignmentExpression(TreeBuilder& context)
+template <typename LexerType>
+template <typename TreeBuilder> TreeExpression JSParser<LexerType>::parseAssignmentExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(AssignmentExpression);
     failIfStackOverflow();
     int start = tokenStart();
     int initialAssignmentCount = m_assignmentCount;
@@ -1018,8 +1253,11 @@ end:
     return lhs;
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseConditionalExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseConditionalExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ConditionalExpression);
+    int start = tokenStart();
     TreeExpression cond = parseBinaryExpression(context);
     failIfFalse(cond);
     if (!match(QUESTION))
@@ -1031,7 +1269,9 @@ template <class TreeBuilder> TreeExpression JSParser::parseConditionalExpression
 
     TreeExpression rhs = parseAssignmentExpression(context);
     failIfFalse(rhs);
-    return context.createConditionalExpr(cond, lhs, rhs);
+    TreeExpression conditional = context.createConditionalExpr(cond, lhs, rhs);
+    context.setRange(conditional, start, lastTokenEnd());
+    return conditional;
 }
 
 ALWAYS_INLINE static bool isUnaryOp(JSTokenType token)
@@ -1039,15 +1279,18 @@ ALWAYS_INLINE static bool isUnaryOp(JSTokenType token)
     return token & UnaryOpTokenFlag;
 }
 
-int JSParser::isBinaryOperator(JSTokenType token)
+template <typename LexerType>
+int JSParser<LexerType>::isBinaryOperator(JSTokenType token)
 {
     if (m_allowsIn)
         return token & (BinaryOpTokenPrecedenceMask << BinaryOpTokenAllowsInPrecedenceAdditionalShift);
     return token & BinaryOpTokenPrecedenceMask;
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseBinaryExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseBinaryExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(BinaryExpression);
 
     int operandStackDepth = 0;
     int operatorStackDepth = 0;
@@ -1090,8 +1333,10 @@ template <class TreeBuilder> TreeExpression JSParser::parseBinaryExpression(Tree
 }
 
 
-template <bool complete, class TreeBuilder> TreeProperty JSParser::parseProperty(TreeBuilder& context)
+template <typename LexerType>
+template <bool complete, class TreeBuilder> TreeProperty JSParser<LexerType>::parseProperty(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(Property);
     bool wasIdent = false;
     switch (m_token.m_type) {
     namedProperty:
@@ -1099,7 +1344,7 @@ template <bool complete, class TreeBuilder> TreeProperty JSParser::parseProperty
         wasIdent = true;
     case STRING: {
         const Identifier* ident = m_token.m_data.ident;
-        next(Lexer::IgnoreReservedWords);
+        next(LexerType::IgnoreReservedWords);
         if (match(COLON)) {
             next();
             TreeExpression node = parseAssignmentExpression(context);
@@ -1134,13 +1379,18 @@ template <bool complete, class TreeBuilder> TreeProperty JSParser::parseProperty
     }
     default:
         failIfFalse(m_token.m_type & KeywordTokenFlag);
+        m_token.m_data.ident = m_lexer->keywordIdentifier(m_token.m_info);
         goto namedProperty;
     }
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseObjectLiteral(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseObjectLiteral(TreeBuilder& context)
 {
-    int startOffset = m_token.m_data.intValue;
+    PROFILE_PRODUCTION(ObjectLiteral);
+    // Accessors need the strict parse, which starts over at the open brace.
+    JSToken openBrace = m_token;
+    LexerState afterOpenBrace = m_lexer->state();
     consumeOrFail(OPENBRACE);
 
     if (match(CLOSEBRACE)) {
@@ -1151,8 +1401,8 @@ template <class TreeBuilder> TreeExpression JSParser::parseObjectLiteral(TreeBui
     TreeProperty property = parseProperty<false>(context);
     failIfFalse(property);
     if (!m_syntaxAlreadyValidated && context.getType(property) != PropertyNode::Constant) {
-        m_lexer->setOffset(startOffset);
-        next();
+        m_lexer->restoreState(afterOpenBrace);
+        m_token = openBrace;
         return parseStrictObjectLiteral(context);
     }
     TreePropertyList propertyList = context.createPropertyList(property);
@@ -1165,8 +1415,8 @@ template <class TreeBuilder> TreeExpression JSParser::parseObjectLiteral(TreeBui
         property = parseProperty<false>(context);
         failIfFalse(property);
         if (!m_syntaxAlreadyValidated && context.getType(property) != PropertyNode::Constant) {
-            m_lexer->setOffset(startOffset);
-            next();
+            m_lexer->restoreState(afterOpenBrace);
+            m_token = openBrace;
             return parseStrictObjectLiteral(context);
         }
         tail = context.createPropertyList(property, tail);
@@ -1198,8 +1448,10 @@ public:
     }
 };
 
-template <class TreeBuilder> TreeExpression JSParser::parseStrictObjectLiteral(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseStrictObjectLiteral(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(StrictObjectLiteral);
     consumeOrFail(OPENBRACE);
     
     if (match(CLOSEBRACE)) {
@@ -1243,8 +1495,10 @@ template <class TreeBuilder> TreeExpression JSParser::parseStrictObjectLiteral(T
     return context.createObjectLiteral(propertyList);
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseArrayLiteral(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseArrayLiteral(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(ArrayLiteral);
     consumeOrFail(OPENBRACKET);
 
     int elisions = 0;
@@ -1285,53 +1539,66 @@ template <class TreeBuilder> TreeExpression JSParser::parseArrayLiteral(TreeBuil
     return context.createArray(elementList);
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parsePrimaryExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parsePrimaryExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(PrimaryExpression);
+    int start = tokenStart();
+    TreeExpression result = 0;
     switch (m_token.m_type) {
     case OPENBRACE:
-        return parseObjectLiteral(context);
+        result = parseObjectLiteral(context);
+        break;
     case OPENBRACKET:
-        return parseArrayLiteral(context);
+        result = parseArrayLiteral(context);
+        break;
     case OPENPAREN: {
         next();
         int oldNonLHSCount = m_nonLHSCount;
-        TreeExpression result = parseExpression(context);
+        TreeExpression expression = parseExpression(context);
         m_nonLHSCount = oldNonLHSCount;
         consumeOrFail(CLOSEPAREN);
 
-        return result;
+        // The parenthesized expression keeps its own range.
+        return expression;
     }
     case THISTOKEN: {
         next();
-        return context.thisExpr();
+        result = context.thisExpr();
+        break;
     }
     case IDENT: {
-        int start = tokenStart();
         const Identifier* ident = m_token.m_data.ident;
         next();
-        return context.createResolve(ident, start);
+        result = context.createResolve(ident, start);
+        break;
     }
     case STRING: {
         const Identifier* ident = m_token.m_data.ident;
         next();
-        return context.createString(ident);
+        result = context.createString(ident);
+        break;
     }
     case NUMBER: {
         double d = m_token.m_data.doubleValue;
         next();
-        return context.createNumberExpr(d);
+        result = context.createNumberExpr(d);
+        break;
     }
     case NULLTOKEN: {
         next();
-        return context.createNull();
+        result = context.createNull();
+        break;
     }
     case TRUETOKEN: {
         next();
-        return context.createBoolean(true);
+        result = context.createBoolean(true);
+        break;
     }
     case FALSETOKEN: {
         next();
-        return context.createBoolean(false);
+        result = context.createBoolean(false);
+        break;
     }
     case DIVEQUAL:
     case DIVIDE: {
@@ -1343,17 +1610,24 @@ template <class TreeBuilder> TreeExpression JSParser::parsePrimaryExpression(Tre
         else
             failIfFalse(m_lexer->scanRegExp(pattern, flags));
 
-        int start = tokenStart();
+        // The token only covered the leading slash; extend it over the literal.
+        m_token.m_info.endOffset = m_lexer->currentOffset();
         next();
-        return context.createRegex(*pattern, *flags, start);
+        result = context.createRegex(*pattern, *flags, start);
+        break;
     }
     default:
         fail();
     }
+    if (result)
+        context.setRange(result, start, lastTokenEnd());
+    return result;
 }
 
-template <class TreeBuilder> TreeArguments JSParser::parseArguments(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeArguments JSParser<LexerType>::parseArguments(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(Arguments);
     consumeOrFail(OPENPAREN);
     if (match(CLOSEPAREN)) {
         next();
@@ -1374,8 +1648,10 @@ template <class TreeBuilder> TreeArguments JSParser::parseArguments(TreeBuilder&
     return context.createArguments(argList);
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseMemberExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseMemberExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(MemberExpression);
     TreeExpression base = 0;
     int start = tokenStart();
     int expressionStart = start;
@@ -1394,6 +1670,7 @@ template <class TreeBuilder> TreeExpression JSParser::parseMemberExpression(Tree
         next();
         failIfFalse(parseFunctionInfo<FunctionNoRequirements>(context, name, parameters, body, openBracePos, closeBracePos, bodyStartLine));
         base = context.createFunctionExpr(name, body, parameters, openBracePos, closeBracePos, bodyStartLine, m_lastLine);
+        context.setRange(base, start, lastTokenEnd());
     } else
         base = parsePrimaryExpression(context);
 
@@ -1408,8 +1685,7 @@ template <class TreeBuilder> TreeExpression JSParser::parseMemberExpression(Tree
             TreeExpression property = parseExpression(context);
             failIfFalse(property);
             base = context.createBracketAccess(base, property, initialAssignments != m_assignmentCount, expressionStart, expressionEnd, tokenEnd());
-            if (!consume(CLOSEBRACKET))
-                fail();
+            consumeOrFail(CLOSEBRACKET);
             m_nonLHSCount = nonLHSCount;
             break;
         }
@@ -1435,7 +1711,7 @@ template <class TreeBuilder> TreeExpression JSParser::parseMemberExpression(Tree
         }
         case DOT: {
             int expressionEnd = lastTokenEnd();
-            next(Lexer::IgnoreReservedWords);
+            next(LexerType::IgnoreReservedWords);
             matchOrFail(IDENT);
             base = context.createDotAccess(base, *m_token.m_data.ident, expressionStart, expressionEnd, tokenEnd());
             next();
@@ -1444,15 +1720,20 @@ template <class TreeBuilder> TreeExpression JSParser::parseMemberExpression(Tree
         default:
             goto endMemberExpression;
         }
+        context.setRange(base, expressionStart, lastTokenEnd());
     }
 endMemberExpression:
-    while (newCount--)
+    while (newCount--) {
         base = context.createNewExpr(base, start, lastTokenEnd());
+        context.setRange(base, start, lastTokenEnd());
+    }
     return base;
 }
 
-template <class TreeBuilder> TreeExpression JSParser::parseUnaryExpression(TreeBuilder& context)
+template <typename LexerType>
+template <class TreeBuilder> TreeExpression JSParser<LexerType>::parseUnaryExpression(TreeBuilder& context)
 {
+    PROFILE_PRODUCTION(UnaryExpression);
     AllowInOverride allowInOverride(this);
     int tokenStackDepth = 0;
     while (isUnaryOp(m_token.m_type)) {
@@ -1469,12 +1750,14 @@ template <class TreeBuilder> TreeExpression JSParser::parseUnaryExpression(TreeB
         expr = context.makePostfixNode(expr, OpPlusPlus, subExprStart, lastTokenEnd(), tokenEnd());
         m_assignmentCount++;
         next();
+        context.setRange(expr, subExprStart, lastTokenEnd());
         break;
     case MINUSMINUS:
         m_nonLHSCount++;
         expr = context.makePostfixNode(expr, OpMinusMinus, subExprStart, lastTokenEnd(), tokenEnd());
         m_assignmentCount++;
         next();
+        context.setRange(expr, subExprStart, lastTokenEnd());
         break;
     default:
         break;
@@ -1523,6 +1806,7 @@ template <class TreeBuilder> TreeExpression JSParser::parseUnaryExpression(TreeB
             CRASH();
         }
         subExprStart = context.unaryTokenStackLastStart(tokenStackDepth);
+        context.setRange(expr, subExprStart, end);
         context.unaryTokenStackRemoveLast(tokenStackDepth);
     }
     return expr;
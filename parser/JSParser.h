@@ -26,14 +26,22 @@
 #ifndef JSParser_h
 #define JSParser_h
 
+#include <wtf/Vector.h>
+
 namespace JSC {
 
 class Identifier;
 class JSGlobalData;
 class JSObject;
+class ParserArena;
 class SourceCode;
+template <typename T> class Lexer;
 class UString;
 
+namespace SyntaxTree {
+class Node;
+}
+
 enum {
     UnaryOpTokenFlag = 64,
     KeywordTokenFlag = 128,
@@ -156,7 +164,37 @@ struct JSToken {
     JSTokenInfo m_info;
 };
 
-UString jsCreateSyntaxTree(JSGlobalData*, const SourceCode*);
+// A syntax error found by a parse that recovers from errors.
+struct ParseDiagnostic {
+    ParseDiagnostic(int offset, int line, JSTokenType found, JSTokenType expected)
+        : offset(offset)
+        , line(line)
+        , found(found)
+        , expected(expected)
+    {
+    }
+
+    // Where the token that could not be parsed starts, or where the lexer
+    // stopped if it could not make a token there.
+    int offset;
+    int line;
+    // ERRORTOK if the lexer could not make a token.
+    JSTokenType found;
+    // ERRORTOK if no particular token was expected.
+    JSTokenType expected;
+};
+
+// Skipped function bodies are left as unparsed nodes, see Node::isUnparsed().
+enum FunctionBodyMode { ParseFunctionBodies, SkipFunctionBodies };
+
+// With diagnostics, errors do not stop the parse: the statements they are
+// found in are left out of the tree and the errors are appended to the vector.
+template <typename LexerType>
+SyntaxTree::Node* jsParse(JSGlobalData*, LexerType*, const SourceCode*, ParserArena&, FunctionBodyMode = ParseFunctionBodies, Vector<ParseDiagnostic>* diagnostics = 0);
+
+// Parses source that is a function body from its opening to its closing brace.
+template <typename LexerType>
+SyntaxTree::Node* jsParseFunctionBody(JSGlobalData*, LexerType*, const SourceCode*, ParserArena&, FunctionBodyMode = ParseFunctionBodies);
 
 } // namespace JSC
 
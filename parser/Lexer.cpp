@@ -24,6 +24,7 @@
 #include "config.h"
 #include "Lexer.h"
 
+#include "CharacterScanner.h"
 #include "JSGlobalObjectFunctions.h"
 #include "Identifier.h"
 #include "Nodes.h"
@@ -38,6 +39,7 @@ using namespace Unicode;
 
 #include "JSParser.h"
 #include "Lookup.h"
+#include "PunctuatorTable.h"
 
 namespace JSC {
 
@@ -217,38 +219,71 @@ static const unsigned short typesOfASCIICharacters[128] = {
 /* 127 - Delete             */ CharacterInvalid,
 };
 
-Lexer::Lexer(JSGlobalData* globalData)
+template <typename T>
+Lexer<T>::Lexer(JSGlobalData* globalData)
     : m_isReparsing(false)
+    , m_parserArena(0)
+    , m_sourceLines(0)
+    , m_recordedBraces(0)
+    , m_knownBraces(0)
+    , m_trivia(0)
+    , m_triviaStart(-1)
     , m_globalData(globalData)
     , m_keywordTable(JSC::mainTable)
 {
 }
 
-Lexer::~Lexer()
+template <typename T>
+Lexer<T>::~Lexer()
 {
     m_keywordTable.deleteTable();
 }
 
-ALWAYS_INLINE const UChar* Lexer::currentCharacter() const
+template <typename T>
+ALWAYS_INLINE const T* Lexer<T>::currentCharacter() const
 {
     ASSERT(m_code <= m_codeEnd);
     return m_code;
 }
 
-ALWAYS_INLINE int Lexer::currentOffset() const
+template <typename T>
+ALWAYS_INLINE int Lexer<T>::currentOffset() const
 {
     return currentCharacter() - m_codeStart;
 }
 
-void Lexer::setCode(const SourceCode& source, ParserArena& arena)
+template <typename T>
+static inline const T* sourceCharacters(const SourceProvider*);
+
+template <>
+inline const LChar* sourceCharacters<LChar>(const SourceProvider* provider)
+{
+    ASSERT(provider->is8Bit());
+    return provider->data8();
+}
+
+template <>
+inline const UChar* sourceCharacters<UChar>(const SourceProvider* provider)
+{
+    ASSERT(!provider->is8Bit());
+    return provider->data();
+}
+
+template <typename T>
+void Lexer<T>::setCode(const SourceCode& source, ParserArena& arena, SourceLines* sourceLines)
 {
     m_arena = &arena.identifierArena();
+    m_sourceLines = sourceLines;
+    if (m_sourceLines)
+        m_sourceLines->reset(source.firstLine(), source.startOffset());
 
     m_lineNumber = source.firstLine();
+    m_lastLineNumber = m_lineNumber;
+    m_terminator = false;
     m_delimited = false;
     m_lastToken = -1;
 
-    const UChar* data = source.provider()->data();
+    const T* data = sourceCharacters<T>(source.provider());
 
     m_source = &source;
     m_codeStart = data;
@@ -256,9 +291,15 @@ void Lexer::setCode(const SourceCode& source, ParserArena& arena)
     m_codeEnd = data + source.endOffset();
     m_error = false;
     m_atLineStart = true;
+    m_triviaStart = -1;
 
-    m_buffer8.reserveInitialCapacity(initialReadBufferCapacity);
-    m_buffer16.reserveInitialCapacity((m_codeEnd - m_code) / 2);
+    // The buffers of the arena are borrowed until clear(), so that they keep
+    // the capacity they grew to for the next parse into the arena.
+    m_parserArena = &arena;
+    m_buffer8.swap(arena.lexerBuffer8());
+    m_buffer16.swap(arena.lexerBuffer16());
+    m_buffer8.reserveCapacity(initialReadBufferCapacity);
+    m_buffer16.reserveCapacity(initialReadBufferCapacity);
 
     if (LIKELY(m_code < m_codeEnd))
         m_current = *m_code;
@@ -267,7 +308,8 @@ void Lexer::setCode(const SourceCode& source, ParserArena& arena)
     ASSERT(currentOffset() == source.startOffset());
 }
 
-ALWAYS_INLINE void Lexer::shift()
+template <typename T>
+ALWAYS_INLINE void Lexer<T>::shift()
 {
     // Faster than an if-else sequence
     ASSERT(m_current != -1);
@@ -277,15 +319,26 @@ ALWAYS_INLINE void Lexer::shift()
         m_current = *m_code;
 }
 
-ALWAYS_INLINE int Lexer::peek(int offset)
+template <typename T>
+ALWAYS_INLINE void Lexer<T>::shiftTo(const T* position)
+{
+    // Moves over characters that need no processing, found by the CharacterScanner
+    ASSERT(position >= m_code && position <= m_codeEnd);
+    m_code = position;
+    m_current = (m_code < m_codeEnd) ? *m_code : -1;
+}
+
+template <typename T>
+ALWAYS_INLINE int Lexer<T>::peek(int offset)
 {
     // Only use if necessary
     ASSERT(offset > 0 && offset < 5);
-    const UChar* code = m_code + offset;
+    const T* code = m_code + offset;
     return (code < m_codeEnd) ? *code : -1;
 }
 
-int Lexer::getUnicodeCharacter()
+template <typename T>
+int Lexer<T>::getUnicodeCharacter()
 {
     int char1 = peek(1);
     int char2 = peek(2);
@@ -302,7 +355,8 @@ int Lexer::getUnicodeCharacter()
     return result;
 }
 
-void Lexer::shiftLineTerminator()
+template <typename T>
+void Lexer<T>::shiftLineTerminator()
 {
     ASSERT(isLineTerminator(m_current));
 
@@ -314,21 +368,41 @@ void Lexer::shiftLineTerminator()
         shift();
 
     ++m_lineNumber;
+    if (m_sourceLines)
+        m_sourceLines->append(currentOffset());
 }
 
-ALWAYS_INLINE const Identifier* Lexer::makeIdentifier(const UChar* characters, size_t length)
+template <typename T>
+template <typename CharType>
+ALWAYS_INLINE const Identifier* Lexer<T>::makeIdentifier(const CharType* characters, size_t length)
 {
     return &m_arena->makeIdentifier(m_globalData, characters, length);
 }
 
-ALWAYS_INLINE bool Lexer::lastTokenWasRestrKeyword() const
+// For tokens without escapes: the identifier refers to the source characters
+// instead of a copy of them.
+template <typename T>
+ALWAYS_INLINE const Identifier* Lexer<T>::makeSourceIdentifier(const T* characters, size_t length)
+{
+    ASSERT(characters >= m_codeStart && characters + length <= m_codeEnd);
+    return &m_arena->makeSourceIdentifier(m_globalData, characters, length);
+}
+
+template <typename T>
+const Identifier* Lexer<T>::keywordIdentifier(const JSTokenInfo& info)
+{
+    return makeSourceIdentifier(m_codeStart + info.startOffset, info.endOffset - info.startOffset);
+}
+
+template <typename T>
+ALWAYS_INLINE bool Lexer<T>::lastTokenWasRestrKeyword() const
 {
     return m_lastToken == CONTINUE || m_lastToken == BREAK || m_lastToken == RETURN || m_lastToken == THROW;
 }
 
 static NEVER_INLINE bool isNonASCIIIdentStart(int c)
 {
-    return category(c) & (Letter_Uppercase | Letter_Lowercase | Letter_Titlecase | Letter_Modifier | Letter_Other);
+    return isIdentifierStart(c);
 }
 
 static inline bool isIdentStart(int c)
@@ -338,8 +412,7 @@ static inline bool isIdentStart(int c)
 
 static NEVER_INLINE bool isNonASCIIIdentPart(int c)
 {
-    return category(c) & (Letter_Uppercase | Letter_Lowercase | Letter_Titlecase | Letter_Modifier | Letter_Other
-        | Mark_NonSpacing | Mark_SpacingCombining | Number_DecimalDigit | Punctuation_Connector);
+    return isIdentifierPart(c);
 }
 
 static inline bool isIdentPart(int c)
@@ -376,30 +449,33 @@ static inline int singleEscape(int c)
     }
 }
 
-inline void Lexer::record8(int c)
+template <typename T>
+inline void Lexer<T>::record8(int c)
 {
     ASSERT(c >= 0);
     ASSERT(c <= 0xFF);
     m_buffer8.append(static_cast<char>(c));
 }
 
-inline void Lexer::record16(UChar c)
+template <typename T>
+inline void Lexer<T>::record16(UChar c)
 {
     m_buffer16.append(c);
 }
 
-inline void Lexer::record16(int c)
+template <typename T>
+inline void Lexer<T>::record16(int c)
 {
     ASSERT(c >= 0);
     ASSERT(c <= USHRT_MAX);
     record16(UChar(static_cast<unsigned short>(c)));
 }
 
-ALWAYS_INLINE JSTokenType Lexer::parseIdentifier(JSTokenData* lvalp, LexType lexType)
+template <typename T>
+ALWAYS_INLINE JSTokenType Lexer<T>::parseIdentifier(JSTokenData* lvalp, LexType lexType)
 {
     bool bufferRequired = false;
-    const UChar* identifierStart = currentCharacter();
-    int identifierLength;
+    const T* identifierStart = currentCharacter();
 
     while (true) {
         if (LIKELY(isIdentPart(m_current))) {
@@ -426,38 +502,46 @@ ALWAYS_INLINE JSTokenType Lexer::parseIdentifier(JSTokenData* lvalp, LexType lex
         identifierStart = currentCharacter();
     }
 
-    if (!bufferRequired)
-        identifierLength = currentCharacter() - identifierStart;
-    else {
-        if (identifierStart != currentCharacter())
-            m_buffer16.append(identifierStart, currentCharacter() - identifierStart);
-        identifierStart = m_buffer16.data();
-        identifierLength = m_buffer16.size();
-    }
-
-    const Identifier* ident = makeIdentifier(identifierStart, identifierLength);
-    lvalp->ident = ident;
     m_delimited = false;
 
-    if (LIKELY(!bufferRequired && lexType == IdentifyReservedWords)) {
-        // Keywords must not be recognized if there was an \uXXXX in the identifier.
-        const HashEntry* entry = m_keywordTable.entry(m_globalData, *ident);
-        return entry ? static_cast<JSTokenType>(entry->lexerValue()) : IDENT;
+    if (!bufferRequired) {
+        int identifierLength = currentCharacter() - identifierStart;
+
+        // Keywords are classified from the source characters, so that only real
+        // names create an Identifier.
+        if (LIKELY(lexType == IdentifyReservedWords)) {
+            const HashEntry* entry = m_keywordTable.entry(m_globalData, identifierStart, identifierLength);
+            JSTokenType token = entry ? static_cast<JSTokenType>(entry->lexerValue()) : IDENT;
+            if (token != IDENT)
+                return token;
+        }
+
+        lvalp->ident = makeSourceIdentifier(identifierStart, identifierLength);
+        return IDENT;
     }
 
+    // Keywords must not be recognized if there was an \uXXXX in the identifier.
+    if (identifierStart != currentCharacter())
+        m_buffer16.append(identifierStart, currentCharacter() - identifierStart);
+    lvalp->ident = makeIdentifier(m_buffer16.data(), m_buffer16.size());
     m_buffer16.resize(0);
     return IDENT;
 }
 
-ALWAYS_INLINE bool Lexer::parseString(JSTokenData* lvalp)
+template <typename T>
+ALWAYS_INLINE bool Lexer<T>::parseString(JSTokenData* lvalp)
 {
     int stringQuoteCharacter = m_current;
     shift();
 
-    const UChar* stringStart = currentCharacter();
+    const T* stringStart = currentCharacter();
+
+    while (true) {
+        shiftTo(findStringSpecial(currentCharacter(), m_codeEnd, static_cast<T>(stringQuoteCharacter)));
+        if (m_current == stringQuoteCharacter)
+            break;
 
-    while (m_current != stringQuoteCharacter) {
-        if (UNLIKELY(m_current == '\\')) {
+        if (LIKELY(m_current == '\\')) {
             if (stringStart != currentCharacter())
                 m_buffer16.append(stringStart, currentCharacter() - stringStart);
             shift();
@@ -512,16 +596,16 @@ ALWAYS_INLINE bool Lexer::parseString(JSTokenData* lvalp)
             stringStart = currentCharacter();
             continue;
         }
-        // Fast check for characters that require special handling.
-        // Catches -1, \n, \r, 0x2028, and 0x2029 as efficiently
-        // as possible, and lets through all common ASCII characters.
-        if (UNLIKELY(((static_cast<unsigned>(m_current) - 0xE) & 0x2000))) {
-            // New-line or end of input is not allowed
-            if (UNLIKELY(isLineTerminator(m_current)) || UNLIKELY(m_current == -1))
-                return false;
-            // Anything else is just a normal character
-        }
-        shift();
+
+        // New-line or end of input is not allowed
+        ASSERT(isLineTerminator(m_current) || m_current == -1);
+        return false;
+    }
+
+    // Strings without escapes are not copied into the buffer.
+    if (m_buffer16.isEmpty()) {
+        lvalp->ident = makeSourceIdentifier(stringStart, currentCharacter() - stringStart);
+        return true;
     }
 
     if (currentCharacter() != stringStart)
@@ -531,7 +615,8 @@ ALWAYS_INLINE bool Lexer::parseString(JSTokenData* lvalp)
     return true;
 }
 
-ALWAYS_INLINE void Lexer::parseHex(double& returnValue)
+template <typename T>
+ALWAYS_INLINE void Lexer<T>::parseHex(double& returnValue)
 {
     // Optimization: most hexadecimal values fit into 4 bytes.
     uint32_t hexValue = 0;
@@ -570,7 +655,8 @@ ALWAYS_INLINE void Lexer::parseHex(double& returnValue)
     returnValue = parseIntOverflow(m_buffer8.data(), m_buffer8.size(), 16);
 }
 
-ALWAYS_INLINE bool Lexer::parseOctal(double& returnValue)
+template <typename T>
+ALWAYS_INLINE bool Lexer<T>::parseOctal(double& returnValue)
 {
     // Optimization: most octal values fit into 4 bytes.
     uint32_t octalValue = 0;
@@ -606,74 +692,119 @@ ALWAYS_INLINE bool Lexer::parseOctal(double& returnValue)
     return true;
 }
 
-ALWAYS_INLINE bool Lexer::parseDecimal(double& returnValue)
-{
-    // Optimization: most decimal values fit into 4 bytes.
-    uint32_t decimalValue = 0;
+// Powers of ten that are exactly representable as doubles.
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-    // Since parseOctal may be executed before parseDecimal,
-    // the m_buffer8 may hold ascii digits.
-    if (!m_buffer8.size()) {
-        int maximumDigits = 9;
-        // Temporary buffer for the digits. Makes easier
-        // to reconstruct the input characters when needed.
-        char digits[10];
+static const int maximumExactPowerOfTen = 22;
 
-        do {
-            decimalValue = decimalValue * 10 + (m_current - '0');
-            digits[maximumDigits] = m_current;
-            shift();
-            --maximumDigits;
-        } while (isASCIIDigit(m_current) && maximumDigits >= 0);
+// Enough digits that the mantissa cannot overflow 64 bits.
+static const int maximumMantissaDigits = 19;
 
-        if (maximumDigits >= 0 && m_current != '.' && (m_current | 0x20) != 'e') {
-            returnValue = decimalValue;
-            return true;
-        }
+template <typename T>
+ALWAYS_INLINE bool Lexer<T>::parseDecimal(double& returnValue)
+{
+    ASSERT(isASCIIDigit(m_current) || m_current == '.');
+    const T* numberStart = currentCharacter();
 
-        for (int i = 9; i > maximumDigits; --i)
-            record8(digits[i]);
-    }
+    // The digits are accumulated into an integer mantissa and a decimal exponent.
+    // When the mantissa fits into a double's 53 bits and the power of ten is exact
+    // too, a single multiplication or division gives the correctly rounded value.
+    uint64_t mantissa = 0;
+    int mantissaDigits = 0;
+    int exponent = 0;
+    bool truncated = false;
 
     while (isASCIIDigit(m_current)) {
-        record8(m_current);
+        if (mantissaDigits < maximumMantissaDigits) {
+            mantissa = mantissa * 10 + (m_current - '0');
+            if (mantissa)
+                ++mantissaDigits;
+        } else {
+            ++exponent;
+            truncated |= m_current != '0';
+        }
         shift();
     }
 
-    return false;
-}
-
-ALWAYS_INLINE void Lexer::parseNumberAfterDecimalPoint()
-{
-    record8('.');
-    while (isASCIIDigit(m_current)) {
-        record8(m_current);
+    if (m_current == '.') {
         shift();
+        while (isASCIIDigit(m_current)) {
+            if (mantissaDigits < maximumMantissaDigits) {
+                mantissa = mantissa * 10 + (m_current - '0');
+                if (mantissa)
+                    ++mantissaDigits;
+                --exponent;
+            } else
+                truncated |= m_current != '0';
+            shift();
+        }
     }
-}
 
-ALWAYS_INLINE bool Lexer::parseNumberAfterExponentIndicator()
-{
-    record8('e');
-    shift();
-    if (m_current == '+' || m_current == '-') {
-        record8(m_current);
+    if ((m_current | 0x20) == 'e') {
         shift();
+        bool negative = m_current == '-';
+        if (m_current == '+' || m_current == '-')
+            shift();
+
+        if (!isASCIIDigit(m_current))
+            return false;
+
+        // Large exponents only need to be recognized as such, strtod handles them.
+        int exponentValue = 0;
+        do {
+            if (exponentValue < 10000)
+                exponentValue = exponentValue * 10 + (m_current - '0');
+            shift();
+        } while (isASCIIDigit(m_current));
+        exponent += negative ? -exponentValue : exponentValue;
     }
 
-    if (!isASCIIDigit(m_current))
-        return false;
+    if (LIKELY(!truncated && mantissa <= static_cast<uint64_t>(mantissaOverflowLowerBound)
+        && exponent >= -maximumExactPowerOfTen && exponent <= maximumExactPowerOfTen)) {
+        double value = static_cast<double>(mantissa);
+        if (exponent >= 0)
+            returnValue = value * exactPowersOfTen[exponent];
+        else
+            returnValue = value / exactPowersOfTen[-exponent];
+        return true;
+    }
 
-    do {
-        record8(m_current);
-        shift();
-    } while (isASCIIDigit(m_current));
+    // The literal needs more precision than the fast path provides.
+    for (const T* character = numberStart; character < currentCharacter(); ++character)
+        record8(*character);
+    m_buffer8.append('\0');
+    returnValue = WTF::strtod(m_buffer8.data(), 0);
     return true;
 }
 
-ALWAYS_INLINE bool Lexer::parseMultilineComment()
+template <typename T>
+ALWAYS_INLINE JSTokenType Lexer<T>::parsePunctuator()
+{
+    // Runs the automaton generated from Punctuators.table. Every prefix of a
+    // punctuator is a punctuator too, so the longest match is the state where
+    // no transition continues.
+    ASSERT(isASCII(m_current) && punctuatorCharacterClasses[m_current]);
+    const T* position = currentCharacter();
+    unsigned state = punctuatorTransitions[0][punctuatorCharacterClasses[*position]];
+    while (++position < m_codeEnd && isASCII(*position)) {
+        unsigned nextState = punctuatorTransitions[state][punctuatorCharacterClasses[*position]];
+        if (!nextState)
+            break;
+        state = nextState;
+    }
+    shiftTo(position);
+    return punctuatorTokens[state];
+}
+
+template <typename T>
+ALWAYS_INLINE bool Lexer<T>::parseMultilineComment()
 {
     while (true) {
+        shiftTo(findStarOrLineTerminator(currentCharacter(), m_codeEnd));
+
         while (UNLIKELY(m_current == '*')) {
             shift();
             if (m_current == '/') {
@@ -692,7 +823,26 @@ ALWAYS_INLINE bool Lexer::parseMultilineComment()
     }
 }
 
-JSTokenType Lexer::lex(JSTokenData* lvalp, JSTokenInfo* llocp, LexType lexType)
+template <typename T>
+void Lexer<T>::recordLeadingTrivia(int triviaStart, int tokenStart, JSTokenType token)
+{
+    ASSERT(m_trivia);
+    if (m_triviaStart != -1) {
+        triviaStart = m_triviaStart;
+        m_triviaStart = -1;
+    }
+
+    // A semicolon inserted at a line break takes no characters of its own;
+    // the trivia before it lead the next token instead.
+    if (token == SEMICOLON && m_codeStart[tokenStart] != ';') {
+        m_triviaStart = triviaStart;
+        return;
+    }
+    m_trivia->addLeadingTrivia(triviaStart, tokenStart);
+}
+
+template <typename T>
+JSTokenType Lexer<T>::lex(JSTokenData* lvalp, JSTokenInfo* llocp, LexType lexType)
 {
     ASSERT(!m_error);
     ASSERT(m_buffer8.isEmpty());
@@ -700,15 +850,21 @@ JSTokenType Lexer::lex(JSTokenData* lvalp, JSTokenInfo* llocp, LexType lexType)
 
     JSTokenType token = ERRORTOK;
     m_terminator = false;
+    int triviaStart = currentOffset();
 
 start:
-    while (isWhiteSpace(m_current))
-        shift();
+    while (isWhiteSpace(m_current)) {
+        // Indentation comes in runs of spaces and tabs; skip them in bulk.
+        shiftTo(skipSpacesAndTabs(currentCharacter() + 1, m_codeEnd));
+    }
 
     int startOffset = currentOffset();
 
-    if (UNLIKELY(m_current == -1))
+    if (UNLIKELY(m_current == -1)) {
+        if (UNLIKELY(m_trivia))
+            recordLeadingTrivia(triviaStart, startOffset, EOFTOK);
         return EOFTOK;
+    }
 
     m_delimited = false;
 
@@ -723,126 +879,47 @@ start:
         type = CharacterInvalid;
 
     switch (type) {
-    case CharacterGreater:
-        shift();
-        if (m_current == '>') {
-            shift();
-            if (m_current == '>') {
-                shift();
-                if (m_current == '=') {
-                    shift();
-                    token = URSHIFTEQUAL;
-                    break;
-                }
-                token = URSHIFT;
-                break;
-            }
-            if (m_current == '=') {
-                shift();
-                token = RSHIFTEQUAL;
-                break;
-            }
-            token = RSHIFT;
-            break;
-        }
-        if (m_current == '=') {
-            shift();
-            token = GE;
-            break;
-        }
-        token = GT;
-        break;
-    case CharacterEqual:
-        shift();
-        if (m_current == '=') {
-            shift();
-            if (m_current == '=') {
-                shift();
-                token = STREQ;
-                break;
-            }
-            token = EQEQ;
-            break;
-        }
-        token = EQUAL;
-        break;
     case CharacterLess:
-        shift();
-        if (m_current == '!' && peek(1) == '-' && peek(2) == '-') {
+        if (peek(1) == '!' && peek(2) == '-' && peek(3) == '-') {
             // <!-- marks the beginning of a line comment (for www usage)
+            shift();
             goto inSingleLineComment;
         }
-        if (m_current == '<') {
+        goto inPunctuator;
+    case CharacterSub:
+        if (m_atLineStart && peek(1) == '-' && peek(2) == '>') {
+            // --> at the beginning of a line marks a line comment as well
             shift();
-            if (m_current == '=') {
-                shift();
-                token = LSHIFTEQUAL;
-                break;
-            }
-            token = LSHIFT;
-            break;
-        }
-        if (m_current == '=') {
             shift();
-            token = LE;
-            break;
-        }
-        token = LT;
-        break;
-    case CharacterExclamationMark:
-        shift();
-        if (m_current == '=') {
             shift();
-            if (m_current == '=') {
-                shift();
-                token = STRNEQ;
-                break;
-            }
-            token = NE;
-            break;
+            goto inSingleLineComment;
         }
-        token = EXCLAMATION;
-        break;
+        // Fall through into the other punctuators.
+    case CharacterGreater:
+    case CharacterEqual:
+    case CharacterExclamationMark:
     case CharacterAdd:
-        shift();
-        if (m_current == '+') {
-            shift();
-            token = (!m_terminator) ? PLUSPLUS : AUTOPLUSPLUS;
-            break;
-        }
-        if (m_current == '=') {
-            shift();
-            token = PLUSEQUAL;
-            break;
-        }
-        token = PLUS;
-        break;
-    case CharacterSub:
-        shift();
-        if (m_current == '-') {
-            shift();
-            if (m_atLineStart && m_current == '>') {
-                shift();
-                goto inSingleLineComment;
-            }
-            token = (!m_terminator) ? MINUSMINUS : AUTOMINUSMINUS;
-            break;
-        }
-        if (m_current == '=') {
-            shift();
-            token = MINUSEQUAL;
-            break;
-        }
-        token = MINUS;
-        break;
     case CharacterMultiply:
-        shift();
-        if (m_current == '=') {
-            shift();
-            token = MULTEQUAL;
-            break;
+    case CharacterAnd:
+    case CharacterXor:
+    case CharacterModulo:
+    case CharacterOr:
+    case CharacterOpenParen:
+    case CharacterCloseParen:
+    case CharacterOpenBracket:
+    case CharacterCloseBracket:
+    case CharacterComma:
+    case CharacterColon:
+    case CharacterQuestion:
+    case CharacterTilde:
+inPunctuator:
+        token = parsePunctuator();
+        if (UNLIKELY(m_terminator)) {
+            if (token == PLUSPLUS)
+                token = AUTOPLUSPLUS;
+            else if (token == MINUSMINUS)
+                token = AUTOMINUSMINUS;
         }
-        token = TIMES;
         break;
     case CharacterSlash:
         shift();
@@ -852,9 +929,11 @@ start:
         }
         if (m_current == '*') {
             shift();
-            if (parseMultilineComment())
-                goto start;
-            goto returnError;
+            if (!parseMultilineComment())
+                goto returnError;
+            if (UNLIKELY(m_trivia))
+                m_trivia->addComment(startOffset, currentOffset());
+            goto start;
         }
         if (m_current == '=') {
             shift();
@@ -863,84 +942,6 @@ start:
         }
         token = DIVIDE;
         break;
-    case CharacterAnd:
-        shift();
-        if (m_current == '&') {
-            shift();
-            token = AND;
-            break;
-        }
-        if (m_current == '=') {
-            shift();
-            token = ANDEQUAL;
-            break;
-        }
-        token = BITAND;
-        break;
-    case CharacterXor:
-        shift();
-        if (m_current == '=') {
-            shift();
-            token = XOREQUAL;
-            break;
-        }
-        token = BITXOR;
-        break;
-    case CharacterModulo:
-        shift();
-        if (m_current == '=') {
-            shift();
-            token = MODEQUAL;
-            break;
-        }
-        token = MOD;
-        break;
-    case CharacterOr:
-        shift();
-        if (m_current == '=') {
-            shift();
-            token = OREQUAL;
-            break;
-        }
-        if (m_current == '|') {
-            shift();
-            token = OR;
-            break;
-        }
-        token = BITOR;
-        break;
-    case CharacterOpenParen:
-        token = OPENPAREN;
-        shift();
-        break;
-    case CharacterCloseParen:
-        token = CLOSEPAREN;
-        shift();
-        break;
-    case CharacterOpenBracket:
-        token = OPENBRACKET;
-        shift();
-        break;
-    case CharacterCloseBracket:
-        token = CLOSEBRACKET;
-        shift();
-        break;
-    case CharacterComma:
-        token = COMMA;
-        shift();
-        break;
-    case CharacterColon:
-        token = COLON;
-        shift();
-        break;
-    case CharacterQuestion:
-        token = QUESTION;
-        shift();
-        break;
-    case CharacterTilde:
-        token = TILDE;
-        shift();
-        break;
     case CharacterSemicolon:
         m_delimited = true;
         shift();
@@ -958,40 +959,35 @@ start:
         token = CLOSEBRACE;
         break;
     case CharacterDot:
-        shift();
-        if (!isASCIIDigit(m_current)) {
+        if (!isASCIIDigit(peek(1))) {
+            shift();
             token = DOT;
             break;
         }
-        goto inNumberAfterDecimalPoint;
+        goto inDecimal;
     case CharacterZero:
-        shift();
-        if ((m_current | 0x20) == 'x' && isASCIIHexDigit(peek(1))) {
+        if ((peek(1) | 0x20) == 'x' && isASCIIHexDigit(peek(2))) {
+            shift();
             parseHex(lvalp->doubleValue);
             token = NUMBER;
-        } else {
+        } else if (isASCIIOctalDigit(peek(1))) {
+            const T* numberStart = currentCharacter();
+            shift();
             record8('0');
-            if (isASCIIOctalDigit(m_current)) {
-                if (parseOctal(lvalp->doubleValue))
-                    token = NUMBER;
+            if (parseOctal(lvalp->doubleValue))
+                token = NUMBER;
+            else {
+                // An 8 or 9 makes it a decimal literal after all, such as 0778.
+                m_buffer8.resize(0);
+                setOffset(numberStart - m_codeStart);
             }
         }
         // Fall through into CharacterNumber
     case CharacterNumber:
         if (LIKELY(token != NUMBER)) {
-            if (!parseDecimal(lvalp->doubleValue)) {
-                if (m_current == '.') {
-                    shift();
-inNumberAfterDecimalPoint:
-                    parseNumberAfterDecimalPoint();
-                }
-                if ((m_current | 0x20) == 'e')
-                    if (!parseNumberAfterExponentIndicator())
-                        goto returnError;
-                // Null-terminate string for strtod.
-                m_buffer8.append('\0');
-                lvalp->doubleValue = WTF::strtod(m_buffer8.data(), 0);
-            }
+inDecimal:
+            if (!parseDecimal(lvalp->doubleValue))
+                goto returnError;
             token = NUMBER;
         }
 
@@ -1036,10 +1032,13 @@ inNumberAfterDecimalPoint:
     goto returnToken;
 
 inSingleLineComment:
-    while (!isLineTerminator(m_current)) {
-        if (UNLIKELY(m_current == -1))
-            return EOFTOK;
-        shift();
+    shiftTo(findLineTerminator(currentCharacter(), m_codeEnd));
+    if (UNLIKELY(m_trivia))
+        m_trivia->addComment(startOffset, currentOffset());
+    if (UNLIKELY(m_current == -1)) {
+        if (UNLIKELY(m_trivia))
+            recordLeadingTrivia(triviaStart, currentOffset(), EOFTOK);
+        return EOFTOK;
     }
     shiftLineTerminator();
     m_atLineStart = true;
@@ -1056,6 +1055,8 @@ returnToken:
     llocp->startOffset = startOffset;
     llocp->endOffset = currentOffset();
     m_lastToken = token;
+    if (UNLIKELY(m_trivia))
+        recordLeadingTrivia(triviaStart, startOffset, token);
     return token;
 
 returnError:
@@ -1063,34 +1064,33 @@ returnError:
     return ERRORTOK;
 }
 
-bool Lexer::scanRegExp(const Identifier*& pattern, const Identifier*& flags, UChar patternPrefix)
+template <typename T>
+bool Lexer<T>::scanRegExp(const Identifier*& pattern, const Identifier*& flags, UChar patternPrefix)
 {
-    ASSERT(m_buffer16.isEmpty());
-
-    bool lastWasEscape = false;
-    bool inBrackets = false;
-
+    // The pattern and the flags are kept exactly as they are written in the
+    // source, escapes included, so both refer to the source characters.
+    const T* patternStart = currentCharacter();
     if (patternPrefix) {
         ASSERT(!isLineTerminator(patternPrefix));
         ASSERT(patternPrefix != '/');
         ASSERT(patternPrefix != '[');
-        record16(patternPrefix);
+        ASSERT(patternStart > m_codeStart && patternStart[-1] == patternPrefix);
+        --patternStart;
     }
 
+    bool lastWasEscape = false;
+    bool inBrackets = false;
+
     while (true) {
         int current = m_current;
 
-        if (isLineTerminator(current) || current == -1) {
-            m_buffer16.resize(0);
+        if (isLineTerminator(current) || current == -1)
             return false;
-        }
-
-        shift();
 
         if (current == '/' && !lastWasEscape && !inBrackets)
             break;
 
-        record16(current);
+        shift();
 
         if (lastWasEscape) {
             lastWasEscape = false;
@@ -1110,21 +1110,20 @@ bool Lexer::scanRegExp(const Identifier*& pattern, const Identifier*& flags, UCh
         }
     }
 
-    pattern = makeIdentifier(m_buffer16.data(), m_buffer16.size());
-    m_buffer16.resize(0);
+    pattern = makeSourceIdentifier(patternStart, currentCharacter() - patternStart);
+    shift();
 
-    while (isIdentPart(m_current)) {
-        record16(m_current);
+    const T* flagsStart = currentCharacter();
+    while (isIdentPart(m_current))
         shift();
-    }
 
-    flags = makeIdentifier(m_buffer16.data(), m_buffer16.size());
-    m_buffer16.resize(0);
+    flags = makeSourceIdentifier(flagsStart, currentCharacter() - flagsStart);
 
     return true;
 }
 
-bool Lexer::skipRegExp()
+template <typename T>
+bool Lexer<T>::skipRegExp()
 {
     bool lastWasEscape = false;
     bool inBrackets = false;
@@ -1164,24 +1163,303 @@ bool Lexer::skipRegExp()
     return true;
 }
 
-void Lexer::clear()
+template <typename T>
+bool Lexer<T>::skipString()
 {
-    m_arena = 0;
+    int quote = m_current;
+    shift();
 
-    Vector<char> newBuffer8;
-    m_buffer8.swap(newBuffer8);
+    while (true) {
+        shiftTo(findStringSpecial(currentCharacter(), m_codeEnd, static_cast<T>(quote)));
+
+        if (m_current == quote) {
+            shift();
+            return true;
+        }
 
-    Vector<UChar> newBuffer16;
-    m_buffer16.swap(newBuffer16);
+        if (m_current != '\\')
+            return false;
+
+        shift();
+        if (isLineTerminator(m_current))
+            shiftLineTerminator();
+        else if (m_current != -1)
+            shift();
+    }
+}
+
+// Words after which a slash starts a regular expression instead of a division.
+template <typename T>
+static bool isKeywordBeforeExpression(const T* word, size_t length)
+{
+    static const char* const keywords[] = { "case", "delete", "do", "else", "in", "instanceof", "new", "return", "throw", "typeof", "void" };
+
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+        const char* keyword = keywords[i];
+        size_t j = 0;
+        while (j < length && keyword[j] && keyword[j] == word[j])
+            ++j;
+        if (j == length && !keyword[j])
+            return true;
+    }
+    return false;
+}
+
+// Words whose parenthesized condition is followed by a statement, which may
+// start with a regular expression.
+template <typename T>
+static bool isKeywordBeforeCondition(const T* word, size_t length)
+{
+    static const char* const keywords[] = { "for", "if", "while", "with" };
+
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i) {
+        const char* keyword = keywords[i];
+        size_t j = 0;
+        while (j < length && keyword[j] && keyword[j] == word[j])
+            ++j;
+        if (j == length && !keyword[j])
+            return true;
+    }
+    return false;
+}
+
+// Moves over the statements of a function body without building tokens, up to
+// the closing brace that matches the opening one just read, which is left for
+// lex(). Strings, comments and regular expressions are skipped as a whole. A
+// slash starts a regular expression unless it follows an operand: a closing
+// parenthesis ends one, except that of an if, for, while or with condition,
+// and a closing brace is taken to end a block, which an object literal before
+// a slash would not. Returns false, recording no braces, if the body is not
+// terminated or a parenthesis is unmatched.
+template <typename T>
+bool Lexer<T>::skipFunctionBody()
+{
+    // The opening brace was the last character read.
+    int openBrace = currentOffset() - 1;
+    ASSERT(m_codeStart[openBrace] == '{');
+
+    if (m_knownBraces) {
+        if (const BraceMatches::Match* match = m_knownBraces->find(openBrace)) {
+            m_lineNumber += match->lineCount;
+            shiftTo(m_codeStart + match->closeBrace);
+            m_terminator = false;
+            m_atLineStart = false;
+            return true;
+        }
+    }
+
+    // Every brace inside is recorded as well, so that the bodies of nested
+    // functions can be jumped over once this one is parsed.
+    Vector<std::pair<size_t, int>, 16> openBraces;
+    if (m_recordedBraces)
+        openBraces.append(std::make_pair(m_recordedBraces->open(openBrace), m_lineNumber));
+
+    size_t recordedBraceCount = m_recordedBraces ? m_recordedBraces->size() : 0;
+    int depth = 0;
+    bool regExpAllowed = true;
+    // For each open parenthesis, whether it starts a condition.
+    Vector<bool, 16> openParens;
+    bool conditionKeyword = false;
+
+    while (true) {
+        int current = m_current;
+
+        if (current == -1)
+            goto fail;
+
+        if (isLineTerminator(current)) {
+            shiftLineTerminator();
+            continue;
+        }
+
+        if (isWhiteSpace(current)) {
+            shiftTo(skipSpacesAndTabs(currentCharacter() + 1, m_codeEnd));
+            continue;
+        }
+
+        bool followsConditionKeyword = conditionKeyword;
+        conditionKeyword = false;
+
+        switch (current) {
+        case '(':
+            openParens.append(followsConditionKeyword);
+            regExpAllowed = true;
+            shift();
+            continue;
+        case '{':
+            if (m_recordedBraces)
+                openBraces.append(std::make_pair(m_recordedBraces->open(currentOffset()), m_lineNumber));
+            ++depth;
+            regExpAllowed = true;
+            shift();
+            continue;
+        case '}':
+            if (m_recordedBraces) {
+                m_recordedBraces->close(openBraces.last().first, currentOffset(), m_lineNumber - openBraces.last().second);
+                openBraces.removeLast();
+            }
+            if (!depth) {
+                m_terminator = false;
+                m_atLineStart = false;
+                return true;
+            }
+            --depth;
+            regExpAllowed = true;
+            shift();
+            continue;
+        case ')':
+            if (openParens.isEmpty())
+                goto fail;
+            regExpAllowed = openParens.last();
+            openParens.removeLast();
+            shift();
+            continue;
+        case ']':
+            regExpAllowed = false;
+            shift();
+            continue;
+        case '"':
+        case '\'':
+            if (!skipString())
+                goto fail;
+            regExpAllowed = false;
+            continue;
+        case '/':
+            if (peek(1) == '/') {
+                shiftTo(findLineTerminator(currentCharacter(), m_codeEnd));
+                conditionKeyword = followsConditionKeyword;
+                continue;
+            }
+            if (peek(1) == '*') {
+                shift();
+                shift();
+                if (!parseMultilineComment())
+                    goto fail;
+                conditionKeyword = followsConditionKeyword;
+                continue;
+            }
+            shift();
+            if (regExpAllowed) {
+                if (!skipRegExp())
+                    goto fail;
+                regExpAllowed = false;
+            } else
+                regExpAllowed = true;
+            continue;
+        case '+':
+        case '-':
+            shift();
+            // ++ and -- leave the context of their operand unchanged.
+            if (m_current == current)
+                shift();
+            else
+                regExpAllowed = true;
+            continue;
+        }
+
+        if (isIdentStart(current) || current == '\\') {
+            const T* word = currentCharacter();
+            do {
+                shift();
+            } while (isIdentPart(m_current) || m_current == '\\');
+            regExpAllowed = isKeywordBeforeExpression(word, currentCharacter() - word);
+            conditionKeyword = isKeywordBeforeCondition(word, currentCharacter() - word);
+            continue;
+        }
+
+        if (isASCIIDigit(current)) {
+            do {
+                shift();
+            } while (isIdentPart(m_current) || m_current == '.');
+            regExpAllowed = false;
+            continue;
+        }
+
+        regExpAllowed = true;
+        shift();
+    }
+
+fail:
+    if (m_recordedBraces)
+        m_recordedBraces->shrink(recordedBraceCount);
+    m_error = true;
+    return false;
+}
+
+template <typename T>
+void Lexer<T>::clear()
+{
+    m_arena = 0;
+    m_sourceLines = 0;
+    m_recordedBraces = 0;
+    m_knownBraces = 0;
+    m_trivia = 0;
+
+    if (m_parserArena) {
+        m_buffer8.resize(0);
+        m_buffer8.swap(m_parserArena->lexerBuffer8());
+        m_buffer16.resize(0);
+        m_buffer16.swap(m_parserArena->lexerBuffer16());
+        m_parserArena = 0;
+    }
 
     m_isReparsing = false;
 }
 
-SourceCode Lexer::sourceCode(int openBrace, int closeBrace, int firstLine)
+template <typename T>
+LexerState Lexer<T>::state() const
 {
-    ASSERT(m_source->provider()->data()[openBrace] == '{');
-    ASSERT(m_source->provider()->data()[closeBrace] == '}');
+    ASSERT(m_buffer8.isEmpty());
+    ASSERT(m_buffer16.isEmpty());
+
+    LexerState state;
+    state.offset = currentOffset();
+    state.lineNumber = m_lineNumber;
+    state.lastLineNumber = m_lastLineNumber;
+    state.lastToken = m_lastToken;
+    state.terminator = m_terminator;
+    state.delimited = m_delimited;
+    state.atLineStart = m_atLineStart;
+    return state;
+}
+
+template <typename T>
+void Lexer<T>::restoreState(const LexerState& state)
+{
+    ASSERT(state.offset >= m_source->startOffset() && state.offset <= m_source->endOffset());
+
+    m_code = m_codeStart + state.offset;
+    m_current = m_code < m_codeEnd ? *m_code : -1;
+    m_lineNumber = state.lineNumber;
+    m_lastLineNumber = state.lastLineNumber;
+    m_lastToken = state.lastToken;
+    m_terminator = state.terminator;
+    m_delimited = state.delimited;
+    m_atLineStart = state.atLineStart;
+    m_error = false;
+    m_triviaStart = -1;
+}
+
+template <typename T>
+void Lexer<T>::recoverFromError()
+{
+    m_buffer8.resize(0);
+    m_buffer16.resize(0);
+    shiftTo(findLineTerminator(currentCharacter(), m_codeEnd));
+    m_error = false;
+    m_triviaStart = -1;
+}
+
+template <typename T>
+SourceCode Lexer<T>::sourceCode(int openBrace, int closeBrace, int firstLine)
+{
+    ASSERT(m_codeStart[openBrace] == '{');
+    ASSERT(m_codeStart[closeBrace] == '}');
     return SourceCode(m_source->provider(), openBrace, closeBrace + 1, firstLine);
 }
 
+// Explicit instantiations
+template class Lexer<LChar>;
+template class Lexer<UChar>;
+
 } // namespace JSC
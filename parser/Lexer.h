@@ -23,10 +23,13 @@
 #ifndef Lexer_h
 #define Lexer_h
 
+#include "BraceMatches.h"
 #include "JSParser.h"
 #include "Lookup.h"
 #include "ParserArena.h"
 #include "SourceCode.h"
+#include "SourceLines.h"
+#include "TriviaTable.h"
 #include <wtf/ASCIICType.h>
 #include <wtf/AlwaysInline.h>
 #include <wtf/Vector.h>
@@ -35,8 +38,43 @@ namespace JSC {
 
     class RegExp;
 
+    // Everything the lexer needs to resume between two tokens. It holds only
+    // integers, so snapshots can be kept next to a token stream and copied or
+    // written out as they are.
+    struct LexerState {
+        int offset;
+        int lineNumber;
+        int lastLineNumber;
+        int lastToken;
+        bool terminator;
+        bool delimited;
+        bool atLineStart;
+
+        // Lexing is deterministic, so once relexing after an edit reaches the
+        // state an earlier lex recorded at the same place in the unchanged text,
+        // the remaining tokens are the old ones moved by the edit's offset and
+        // line deltas, and relexing can stop.
+        bool isResynchronizedWith(const LexerState& old, int offsetDelta, int lineDelta) const
+        {
+            return offset == old.offset + offsetDelta
+                && lineNumber == old.lineNumber + lineDelta
+                && lastToken == old.lastToken
+                && terminator == old.terminator
+                && delimited == old.delimited
+                && atLineStart == old.atLineStart;
+        }
+    };
+
+    // Lexes either 8-bit (LChar) or UTF-16 (UChar) source text in place. Both
+    // instantiations are provided by Lexer.cpp.
+    template <typename T>
     class Lexer : public Noncopyable {
     public:
+        typedef T CharacterType;
+
+        Lexer(JSGlobalData*);
+        ~Lexer();
+
         // Character manipulation functions.
         static bool isWhiteSpace(int character);
         static bool isLineTerminator(int character);
@@ -44,9 +82,21 @@ namespace JSC {
         static UChar convertUnicode(int c1, int c2, int c3, int c4);
 
         // Functions to set up parsing.
-        void setCode(const SourceCode&, ParserArena&);
+        void setCode(const SourceCode&, ParserArena&, SourceLines* = 0);
         void setIsReparsing() { m_isReparsing = true; }
 
+        // Braces paired up by skipFunctionBody() are recorded in the first
+        // table; bodies found in the second are jumped over. Either may be 0.
+        void setBraceMatches(BraceMatches* recorded, const BraceMatches* known)
+        {
+            m_recordedBraces = recorded;
+            m_knownBraces = known;
+        }
+
+        // Comments and the trivia before each token read by lex() are
+        // recorded in the table, if given.
+        void setTrivia(TriviaTable* trivia) { m_trivia = trivia; }
+
         // Functions for the parser itself.
         enum LexType { IdentifyReservedWords, IgnoreReservedWords };
         JSTokenType lex(JSTokenData* lvalp, JSTokenInfo* llocp, LexType);
@@ -57,6 +107,12 @@ namespace JSC {
         SourceCode sourceCode(int openBrace, int closeBrace, int firstLine);
         bool scanRegExp(const Identifier*& pattern, const Identifier*& flags, UChar patternPrefix = 0);
         bool skipRegExp();
+        bool skipFunctionBody();
+        // Clears an error and resumes at the end of the line it was found on.
+        void recoverFromError();
+        // Keyword tokens carry no identifier; this makes one for a keyword
+        // that turns out to be a property name.
+        const Identifier* keywordIdentifier(const JSTokenInfo&);
 
         // Functions for use after parsing.
         bool sawError() const { return m_error; }
@@ -68,12 +124,11 @@ namespace JSC {
             m_current = *m_code;
         }
 
-    private:
-        friend class JSGlobalData;
-
-        Lexer(JSGlobalData*);
-        ~Lexer();
+        // Snapshot and resume between tokens, for relexing an edited region.
+        LexerState state() const;
+        void restoreState(const LexerState&);
 
+    private:
         void record8(int);
         void record16(int);
         void record16(UChar);
@@ -81,14 +136,17 @@ namespace JSC {
         void copyCodeWithoutBOMs();
 
         ALWAYS_INLINE void shift();
+        ALWAYS_INLINE void shiftTo(const T* position);
         ALWAYS_INLINE int peek(int offset);
         int getUnicodeCharacter();
         void shiftLineTerminator();
 
-        ALWAYS_INLINE const UChar* currentCharacter() const;
+        ALWAYS_INLINE const T* currentCharacter() const;
         ALWAYS_INLINE int currentOffset() const;
 
-        ALWAYS_INLINE const Identifier* makeIdentifier(const UChar* characters, size_t length);
+        template <typename CharType>
+        ALWAYS_INLINE const Identifier* makeIdentifier(const CharType* characters, size_t length);
+        ALWAYS_INLINE const Identifier* makeSourceIdentifier(const T* characters, size_t length);
 
         ALWAYS_INLINE bool lastTokenWasRestrKeyword() const;
 
@@ -97,9 +155,10 @@ namespace JSC {
         ALWAYS_INLINE void parseHex(double& returnValue);
         ALWAYS_INLINE bool parseOctal(double& returnValue);
         ALWAYS_INLINE bool parseDecimal(double& returnValue);
-        ALWAYS_INLINE void parseNumberAfterDecimalPoint();
-        ALWAYS_INLINE bool parseNumberAfterExponentIndicator();
+        ALWAYS_INLINE JSTokenType parsePunctuator();
         ALWAYS_INLINE bool parseMultilineComment();
+        void recordLeadingTrivia(int triviaStart, int tokenStart, JSTokenType);
+        bool skipString();
 
         static const size_t initialReadBufferCapacity = 32;
 
@@ -113,9 +172,9 @@ namespace JSC {
         int m_lastToken;
 
         const SourceCode* m_source;
-        const UChar* m_code;
-        const UChar* m_codeStart;
-        const UChar* m_codeEnd;
+        const T* m_code;
+        const T* m_codeStart;
+        const T* m_codeEnd;
         bool m_isReparsing;
         bool m_atLineStart;
         bool m_error;
@@ -124,28 +183,39 @@ namespace JSC {
         int m_current;
 
         IdentifierArena* m_arena;
+        ParserArena* m_parserArena;
+        SourceLines* m_sourceLines;
+        BraceMatches* m_recordedBraces;
+        const BraceMatches* m_knownBraces;
+        TriviaTable* m_trivia;
+        // Where the trivia carried over from an inserted semicolon start, or -1.
+        int m_triviaStart;
 
         JSGlobalData* m_globalData;
 
         const HashTable m_keywordTable;
     };
 
-    inline bool Lexer::isWhiteSpace(int ch)
+    template <typename T>
+    inline bool Lexer<T>::isWhiteSpace(int ch)
     {
         return isASCII(ch) ? (ch == ' ' || ch == '\t' || ch == 0xB || ch == 0xC) : (WTF::Unicode::isSeparatorSpace(ch) || ch == 0xFEFF);
     }
 
-    inline bool Lexer::isLineTerminator(int ch)
+    template <typename T>
+    inline bool Lexer<T>::isLineTerminator(int ch)
     {
         return ch == '\r' || ch == '\n' || (ch & ~1) == 0x2028;
     }
 
-    inline unsigned char Lexer::convertHex(int c1, int c2)
+    template <typename T>
+    inline unsigned char Lexer<T>::convertHex(int c1, int c2)
     {
         return (toASCIIHexValue(c1) << 4) | toASCIIHexValue(c2);
     }
 
-    inline UChar Lexer::convertUnicode(int c1, int c2, int c3, int c4)
+    template <typename T>
+    inline UChar Lexer<T>::convertUnicode(int c1, int c2, int c3, int c4)
     {
         return (convertHex(c1, c2) << 8) | convertHex(c3, c4);
     }
@@ -31,6 +31,7 @@
 #include "Identifier.h"
 #include "JSParser.h"
 #include "UString.h"
+#include <wtf/AlwaysInline.h>
 #include <wtf/Assertions.h>
 
 namespace JSC {
@@ -56,164 +57,208 @@ public:
 
     void deleteTable() const {}
 
-    HashEntry* entry(JSGlobalData* globalData, const Identifier& id) const
+    // Classifies the raw identifier characters, so that the lexer does not need
+    // to create an Identifier for a keyword.
+    template <typename T>
+    HashEntry* entry(JSGlobalData*, const T* characters, int length) const
     {
-        m_entry.value = testKeyword(id.ustring().length(), id.ustring().characters());
+        m_entry.value = testKeyword(length, characters);
         return &m_entry;
     }
 
+    HashEntry* entry(JSGlobalData* globalData, const Identifier& id) const
+    {
+        return entry(globalData, id.ustring().characters(), id.ustring().length());
+    }
+
 private:
     mutable HashEntry m_entry;
-    int testKeyword(int len, const UChar *str) const;
+    template <typename T> int testKeyword(int len, const T* str) const;
 };
 
-inline int HashTable::testKeyword(int len, const UChar* str) const
+// Compares the characters after the first one, which the caller has already matched.
+template <typename T>
+static ALWAYS_INLINE bool equalKeywordTail(const T* str, const char* keyword, int length)
+{
+    for (int i = 1; i < length; ++i) {
+        if (str[i] != static_cast<unsigned char>(keyword[i]))
+            return false;
+    }
+    return true;
+}
+
+template <typename T>
+inline int HashTable::testKeyword(int len, const T* str) const
 {
     switch (len) {
     case 2:
-        if (str[0] == 'd' && str[1] == 'o')
-            return DO;
-        else if (str[0] == 'i' && str[1] == 'f')
-            return IF;
-        else if (str[0] == 'i' && str[1] == 'n')
-            return INTOKEN;
+        switch (str[0]) {
+        case 'd':
+            if (str[1] == 'o')
+                return DO;
+            break;
+        case 'i':
+            if (str[1] == 'f')
+                return IF;
+            if (str[1] == 'n')
+                return INTOKEN;
+            break;
+        }
         break;
 
     case 3:
-        if (str[0] == 'f' && str[1] == 'o' && str[2] == 'r')
-            return FOR;
-        else if (str[0] == 'n' && str[1] == 'e' && str[2] == 'w')
-            return NEW;
-        else if (str[0] == 't' && str[1] == 'r' && str[2] == 'y')
-            return TRY;
-        else if (str[0] == 'v' && str[1] == 'a' && str[2] == 'r')
-            return VAR;
+        switch (str[0]) {
+        case 'f':
+            if (equalKeywordTail(str, "for", 3))
+                return FOR;
+            break;
+        case 'n':
+            if (equalKeywordTail(str, "new", 3))
+                return NEW;
+            break;
+        case 't':
+            if (equalKeywordTail(str, "try", 3))
+                return TRY;
+            break;
+        case 'v':
+            if (equalKeywordTail(str, "var", 3))
+                return VAR;
+            break;
+        }
         break;
 
     case 4:
-        if (str[0] == 'c' && str[1] == 'a' && str[2] == 's' && str[3] == 'e')
-            return CASE;
-        else if (str[0] == 'e' && str[1] == 'l' && str[2] == 's' && str[3] == 'e')
-            return ELSE;
-        else if (str[0] == 'e' && str[1] == 'n' && str[2] == 'u' && str[3] == 'm')
-            return RESERVED;
-        else if (str[0] == 'n' && str[1] == 'u' && str[2] == 'l' && str[3] == 'l')
-            return NULLTOKEN;
-        else if (str[0] == 't' && str[1] == 'h' && str[2] == 'i' && str[3] == 's')
-            return THISTOKEN;
-        else if (str[0] == 't' && str[1] == 'r' && str[2] == 'u' && str[3] == 'e')
-            return TRUETOKEN;
-        else if (str[0] == 'v' && str[1] == 'o' && str[2] == 'i' && str[3] == 'd')
-            return VOIDTOKEN;
-        else if (str[0] == 'w' && str[1] == 'i' && str[2] == 't' && str[3] == 'h')
-            return WITH;
+        switch (str[0]) {
+        case 'c':
+            if (equalKeywordTail(str, "case", 4))
+                return CASE;
+            break;
+        case 'e':
+            if (equalKeywordTail(str, "else", 4))
+                return ELSE;
+            if (equalKeywordTail(str, "enum", 4))
+                return RESERVED;
+            break;
+        case 'n':
+            if (equalKeywordTail(str, "null", 4))
+                return NULLTOKEN;
+            break;
+        case 't':
+            if (equalKeywordTail(str, "this", 4))
+                return THISTOKEN;
+            if (equalKeywordTail(str, "true", 4))
+                return TRUETOKEN;
+            break;
+        case 'v':
+            if (equalKeywordTail(str, "void", 4))
+                return VOIDTOKEN;
+            break;
+        case 'w':
+            if (equalKeywordTail(str, "with", 4))
+                return WITH;
+            break;
+        }
         break;
 
     case 5:
-        if (str[0] == 'b' && str[1] == 'r' && str[2] == 'e' && str[3] == 'a' && str[4] == 'k')
-            return BREAK;
-        else if (str[0] == 'c' && str[1] == 'a' && str[2] == 't' && str[3] == 'c' && str[4] == 'h')
-            return CATCH;
-        else if (str[0] == 'c' && str[1] == 'o' && str[2] == 'n' && str[3] == 's' && str[4] == 't')
-            return CONSTTOKEN;
-        else if (str[0] == 'f' && str[1] == 'a' && str[2] == 'l' && str[3] == 's' && str[4] == 'e')
-            return FALSETOKEN;
-        else if (str[0] == 't' && str[1] == 'h' && str[2] == 'r' && str[3] == 'o' && str[4] == 'w')
-            return THROW;
-        else if (str[0] == 'w' && str[1] == 'h' && str[2] == 'i' && str[3] == 'l' && str[4] == 'e')
-            return WHILE;
-        else if (str[0] == 'c' && str[1] == 'l' && str[2] == 'a' && str[3] == 's' && str[4] == 's')
-            return RESERVED;
-        else if (str[0] == 's' && str[1] == 'u' && str[2] == 'p' && str[3] == 'e' && str[4] == 'r')
-            return RESERVED;
+        switch (str[0]) {
+        case 'b':
+            if (equalKeywordTail(str, "break", 5))
+                return BREAK;
+            break;
+        case 'c':
+            if (equalKeywordTail(str, "catch", 5))
+                return CATCH;
+            if (equalKeywordTail(str, "const", 5))
+                return CONSTTOKEN;
+            if (equalKeywordTail(str, "class", 5))
+                return RESERVED;
+            break;
+        case 'f':
+            if (equalKeywordTail(str, "false", 5))
+                return FALSETOKEN;
+            break;
+        case 's':
+            if (equalKeywordTail(str, "super", 5))
+                return RESERVED;
+            break;
+        case 't':
+            if (equalKeywordTail(str, "throw", 5))
+                return THROW;
+            break;
+        case 'w':
+            if (equalKeywordTail(str, "while", 5))
+                return WHILE;
+            break;
+        }
         break;
 
     case 6:
-        if (str[0] == 'd' && str[1] == 'e' && str[2] == 'l' && str[3] == 'e' && str[4] == 't' && str[5]=='e')
-            return DELETETOKEN;
-        else if (str[0] == 's' && str[1] == 'w' && str[2] == 'i' && str[3] == 't' && str[4] == 'c' && str[5]=='h')
-            return SWITCH;
-        else if (str[0] == 'r' && str[1] == 'e' && str[2] == 't' && str[3] == 'u' && str[4] == 'r' && str[5]=='n')
-            return RETURN;
-        else if (str[0] == 't' && str[1] == 'y' && str[2] == 'p' && str[3] == 'e' && str[4] == 'o' && str[5]=='f')
-            return TYPEOF;
-        else if (str[0] == 'e' && str[1] == 'x' && str[2] == 'p' && str[3] == 'o' && str[4] == 'r' && str[5]=='t')
-            return RESERVED;
-        else if (str[0] == 'i' && str[1] == 'm' && str[2] == 'p' && str[3] == 'o' && str[4] == 'r' && str[5]=='t')
-            return RESERVED;
+        switch (str[0]) {
+        case 'd':
+            if (equalKeywordTail(str, "delete", 6))
+                return DELETETOKEN;
+            break;
+        case 'e':
+            if (equalKeywordTail(str, "export", 6))
+                return RESERVED;
+            break;
+        case 'i':
+            if (equalKeywordTail(str, "import", 6))
+                return RESERVED;
+            break;
+        case 'r':
+            if (equalKeywordTail(str, "return", 6))
+                return RETURN;
+            break;
+        case 's':
+            if (equalKeywordTail(str, "switch", 6))
+                return SWITCH;
+            break;
+        case 't':
+            if (equalKeywordTail(str, "typeof", 6))
+                return TYPEOF;
+            break;
+        }
         break;
 
     case 7:
-        if (str[0] == 'd') {
-            if (str[1]=='e')
-                if (str[2]=='f')
-                    if (str[3]=='a')
-                        if (str[4]=='u')
-                            if (str[5]=='l')
-                                if (str[6]=='t')
-                                    return DEFAULT;
-        } else if (str[0] == 'f') {
-            if (str[1]=='i')
-                if (str[2]=='n')
-                    if (str[3]=='a')
-                        if (str[4]=='l')
-                            if (str[5]=='l')
-                                if (str[6]=='y')
-                                    return FINALLY;
-        } else if (str[0] == 'e') {
-            if (str[1]=='x')
-                if (str[2]=='t')
-                    if (str[3]=='e')
-                        if (str[4]=='n')
-                            if (str[5]=='d')
-                                if (str[6]=='s')
-                                    return RESERVED;
+        switch (str[0]) {
+        case 'd':
+            if (equalKeywordTail(str, "default", 7))
+                return DEFAULT;
+            break;
+        case 'e':
+            if (equalKeywordTail(str, "extends", 7))
+                return RESERVED;
+            break;
+        case 'f':
+            if (equalKeywordTail(str, "finally", 7))
+                return FINALLY;
+            break;
         }
         break;
 
     case 8:
-        if (str[0] == 'f') {
-            if (str[1]=='u')
-                if (str[2]=='n')
-                    if (str[3]=='c')
-                        if (str[4]=='t')
-                            if (str[5]=='i')
-                                if (str[6]=='o')
-                                    if (str[7]=='n')
-                                        return FUNCTION;
-        } else if (str[0] == 'c') {
-            if (str[1]=='o')
-                if (str[2]=='n')
-                    if (str[3]=='t')
-                        if (str[4]=='i')
-                            if (str[5]=='n')
-                                if (str[6]=='u')
-                                    if (str[7]=='e')
-                                        return CONTINUE;
-        } else if (str[0] == 'd') {
-            if (str[1]=='e')
-                if (str[2]=='b')
-                    if (str[3]=='u')
-                        if (str[4]=='g')
-                            if (str[5]=='g')
-                                if (str[6]=='e')
-                                    if (str[7]=='r')
-                                        return DEBUGGER;
+        switch (str[0]) {
+        case 'c':
+            if (equalKeywordTail(str, "continue", 8))
+                return CONTINUE;
+            break;
+        case 'd':
+            if (equalKeywordTail(str, "debugger", 8))
+                return DEBUGGER;
+            break;
+        case 'f':
+            if (equalKeywordTail(str, "function", 8))
+                return FUNCTION;
+            break;
         }
         break;
 
     case 10:
-        if (str[0]=='i')
-            if (str[1]=='n')
-                if (str[2]=='s')
-                    if (str[3]=='t')
-                        if (str[4]=='a')
-                            if (str[5]=='n')
-                                if (str[6]=='c')
-                                    if (str[7]=='e')
-                                        if (str[8]=='o')
-                                            if (str[9]=='f')
-                                                return INSTANCEOF;
+        if (str[0] == 'i' && equalKeywordTail(str, "instanceof", 10))
+            return INSTANCEOF;
         break;
 
     default:
@@ -227,4 +272,3 @@ inline int HashTable::testKeyword(int len, const UChar* str) const
 } // namespace JSC
 
 #endif // Lookup_h
-
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "NavigationIndex.h"
+
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+
+namespace JSC {
+
+bool NavigationIndex::isFunction(int type)
+{
+    return type == SyntaxTree::Node::FunctionDeclStatementType
+        || type == SyntaxTree::Node::FunctionExpressionType;
+}
+
+bool NavigationIndex::isStatement(int type)
+{
+    switch (type) {
+    case SyntaxTree::Node::BlockStatementType:
+    case SyntaxTree::Node::BreakStatementType:
+    case SyntaxTree::Node::ConstStatementType:
+    case SyntaxTree::Node::ContinueStatementType:
+    case SyntaxTree::Node::DebuggerType:
+    case SyntaxTree::Node::DoWhileStatementType:
+    case SyntaxTree::Node::EmptyStatementType:
+    case SyntaxTree::Node::ExpressionStatementType:
+    case SyntaxTree::Node::ForInLoopType:
+    case SyntaxTree::Node::ForLoopType:
+    case SyntaxTree::Node::FunctionDeclStatementType:
+    case SyntaxTree::Node::IfStatementType:
+    case SyntaxTree::Node::LabelStatementType:
+    case SyntaxTree::Node::ReturnStatementType:
+    case SyntaxTree::Node::SwitchStatementType:
+    case SyntaxTree::Node::ThrowStatementType:
+    case SyntaxTree::Node::TryStatementType:
+    case SyntaxTree::Node::VariableDeclarationType:
+    case SyntaxTree::Node::WhileStatementType:
+    case SyntaxTree::Node::WithStatementType:
+        return true;
+    default:
+        return false;
+    }
+}
+
+NavigationIndex::NavigationIndex(SyntaxTree::Node* root)
+{
+    if (!root)
+        return;
+
+    Entry rootEntry;
+    rootEntry.node = root;
+    rootEntry.parent = notFound;
+    rootEntry.depth = 0;
+    m_entries.append(rootEntry);
+
+    // Breadth-first, so the children of each node are appended as one run.
+    for (unsigned i = 0; i < m_entries.size(); ++i) {
+        SyntaxTree::Node* n = m_entries[i].node;
+        unsigned firstChild = m_entries.size();
+        unsigned depth = m_entries[i].depth + 1;
+        for (int c = 0; c < n->childCount(); ++c) {
+            SyntaxTree::Node* child = n->childAt(c);
+            if (!child)
+                continue;
+            Entry entry;
+            entry.node = child;
+            entry.parent = i;
+            entry.depth = depth;
+            m_entries.append(entry);
+        }
+        Entry& entry = m_entries[i];
+        entry.firstChild = firstChild;
+        entry.childCount = m_entries.size() - firstChild;
+        entry.start = n->hasRange() ? n->startOffset() : INT_MAX;
+        entry.end = n->hasRange() ? n->endOffset() : INT_MIN;
+        entry.childrenInOrder = true;
+    }
+
+    // Children come after their parents, so a reverse sweep sees every node
+    // fully widened before it widens its parent.
+    for (unsigned i = m_entries.size(); i-- > 1; ) {
+        const Entry& entry = m_entries[i];
+        Entry& parent = m_entries[entry.parent];
+        if (entry.start > entry.end)
+            continue;
+        parent.start = std::min(parent.start, entry.start);
+        parent.end = std::max(parent.end, entry.end);
+    }
+
+    // nodeAt() can binary search the children of a node only if their
+    // ranges are sorted and disjoint, which is the common case.
+    for (unsigned i = 0; i < m_entries.size(); ++i) {
+        Entry& entry = m_entries[i];
+        int lastEnd = INT_MIN;
+        for (unsigned c = entry.firstChild; c < entry.firstChild + entry.childCount; ++c) {
+            const Entry& child = m_entries[c];
+            if (child.start > child.end || child.start < lastEnd) {
+                entry.childrenInOrder = false;
+                break;
+            }
+            lastEnd = child.end;
+        }
+    }
+
+    m_lookup.resize(m_entries.size());
+    for (unsigned i = 0; i < m_entries.size(); ++i) {
+        m_lookup[i].node = m_entries[i].node;
+        m_lookup[i].index = i;
+    }
+    std::sort(m_lookup.begin(), m_lookup.end());
+}
+
+unsigned NavigationIndex::find(SyntaxTree::Node* node) const
+{
+    Lookup key;
+    key.node = node;
+    const Lookup* end = m_lookup.data() + m_lookup.size();
+    const Lookup* result = std::lower_bound(m_lookup.data(), end, key);
+    if (result == end || result->node != node)
+        return notFound;
+    return result->index;
+}
+
+SyntaxTree::Node* NavigationIndex::parent(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    if (index == notFound || m_entries[index].parent == notFound)
+        return 0;
+    return m_entries[m_entries[index].parent].node;
+}
+
+int NavigationIndex::depth(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    return index == notFound ? -1 : static_cast<int>(m_entries[index].depth);
+}
+
+int NavigationIndex::startOffset(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    if (index == notFound || m_entries[index].start > m_entries[index].end)
+        return -1;
+    return m_entries[index].start;
+}
+
+int NavigationIndex::endOffset(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    if (index == notFound || m_entries[index].start > m_entries[index].end)
+        return -1;
+    return m_entries[index].end;
+}
+
+SyntaxTree::Node* NavigationIndex::enclosingFunction(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    if (index == notFound)
+        return 0;
+    for (index = m_entries[index].parent; index != notFound; index = m_entries[index].parent) {
+        if (isFunction(m_entries[index].node->type()))
+            return m_entries[index].node;
+    }
+    return 0;
+}
+
+SyntaxTree::Node* NavigationIndex::enclosingStatement(SyntaxTree::Node* node) const
+{
+    unsigned index = find(node);
+    if (index == notFound)
+        return 0;
+    for (index = m_entries[index].parent; index != notFound; index = m_entries[index].parent) {
+        if (isStatement(m_entries[index].node->type()))
+            return m_entries[index].node;
+    }
+    return 0;
+}
+
+unsigned NavigationIndex::childContaining(const Entry& entry, int offset) const
+{
+    unsigned first = entry.firstChild;
+    unsigned last = entry.firstChild + entry.childCount;
+
+    if (!entry.childrenInOrder) {
+        for (unsigned c = first; c < last; ++c) {
+            if (m_entries[c].start <= offset && offset < m_entries[c].end)
+                return c;
+        }
+        return notFound;
+    }
+
+    // Find the last child starting at or before the offset.
+    while (first < last) {
+        unsigned middle = first + (last - first) / 2;
+        if (m_entries[middle].start <= offset)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    if (first == entry.firstChild)
+        return notFound;
+    const Entry& candidate = m_entries[first - 1];
+    return offset < candidate.end ? first - 1 : notFound;
+}
+
+SyntaxTree::Node* NavigationIndex::nodeAt(int offset) const
+{
+    if (m_entries.isEmpty())
+        return 0;
+    if (offset < m_entries[0].start || offset >= m_entries[0].end)
+        return 0;
+
+    unsigned index = 0;
+    while (true) {
+        unsigned child = childContaining(m_entries[index], offset);
+        if (child == notFound)
+            return m_entries[index].node;
+        index = child;
+    }
+}
+
+} // namespace JSC
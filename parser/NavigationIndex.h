@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NavigationIndex_h
+#define NavigationIndex_h
+
+#include <SyntaxTree.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// Parent links and source ranges for a finished tree, built in one pass on
+// demand. Nodes are laid out breadth-first so that the children of every
+// node are adjacent; a node's range is its own range widened to cover all
+// of its children, so list nodes without a range of their own still get one.
+//
+// Lookups by node are a binary search over the node addresses, walks towards
+// the root are O(depth) after that, and nodeAt() descends from the root
+// with a binary search over the children at each level.
+class NavigationIndex : public Noncopyable
+{
+public:
+    explicit NavigationIndex(SyntaxTree::Node* root);
+
+    SyntaxTree::Node* root() const { return m_entries.isEmpty() ? 0 : m_entries[0].node; }
+    size_t size() const { return m_entries.size(); }
+
+    bool contains(SyntaxTree::Node* node) const { return find(node) != notFound; }
+
+    // All of these return 0 (or -1 for offsets) for nodes not in the tree.
+    SyntaxTree::Node* parent(SyntaxTree::Node*) const;
+    int depth(SyntaxTree::Node*) const;
+    int startOffset(SyntaxTree::Node*) const;
+    int endOffset(SyntaxTree::Node*) const;
+
+    // The nearest proper ancestor that is a function declaration or
+    // expression, or a statement respectively.
+    SyntaxTree::Node* enclosingFunction(SyntaxTree::Node*) const;
+    SyntaxTree::Node* enclosingStatement(SyntaxTree::Node*) const;
+
+    // The innermost node whose range contains the offset.
+    SyntaxTree::Node* nodeAt(int offset) const;
+
+    static bool isFunction(int type);
+    static bool isStatement(int type);
+
+private:
+    static const unsigned notFound = static_cast<unsigned>(-1);
+
+    struct Entry {
+        SyntaxTree::Node* node;
+        unsigned parent;
+        unsigned depth;
+        unsigned firstChild;
+        unsigned childCount;
+        int start;
+        int end;
+        bool childrenInOrder;
+    };
+
+    struct Lookup {
+        SyntaxTree::Node* node;
+        unsigned index;
+
+        bool operator<(const Lookup& other) const { return node < other.node; }
+    };
+
+    unsigned find(SyntaxTree::Node*) const;
+    unsigned childContaining(const Entry&, int offset) const;
+
+    Vector<Entry> m_entries;
+    Vector<Lookup> m_lookup;
+};
+
+} // namespace JSC
+
+#endif // NavigationIndex_h
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "ParallelTraversal.h"
+
+#include "WorkStealingPool.h"
+
+namespace JSC {
+
+ParallelTraversal::ParallelTraversal(unsigned threadCount)
+    : m_threadCount(threadCount)
+{
+}
+
+void ParallelTraversal::collectFunctionBodies(SyntaxTree::Node* root, Vector<SyntaxTree::Node*>& bodies)
+{
+    Vector<SyntaxTree::Node*, 64> stack;
+    stack.append(root);
+    while (!stack.isEmpty()) {
+        SyntaxTree::Node* n = stack.last();
+        stack.removeLast();
+        if (n->type() == SyntaxTree::Node::FunctionBodyType)
+            bodies.append(n);
+        for (int i = n->childCount() - 1; i >= 0; --i) {
+            if (SyntaxTree::Node* child = n->childAt(i))
+                stack.append(child);
+        }
+    }
+}
+
+static void processBody(void* item, unsigned workerIndex, void* context)
+{
+    FunctionBodyVisitor** visitors = static_cast<FunctionBodyVisitor**>(context);
+    visitors[workerIndex]->processFunctionBody(static_cast<SyntaxTree::Node*>(item));
+}
+
+void ParallelTraversal::run(SyntaxTree::Node* root, FunctionBodyVisitor* visitor)
+{
+    Vector<SyntaxTree::Node*> bodies;
+    collectFunctionBodies(root, bodies);
+    if (bodies.isEmpty())
+        return;
+
+    WorkStealingPool pool(m_threadCount);
+    if (pool.threadCount() == 1 || bodies.size() == 1) {
+        for (size_t i = 0; i < bodies.size(); ++i)
+            visitor->processFunctionBody(bodies[i]);
+        return;
+    }
+
+    Vector<FunctionBodyVisitor*> visitors(pool.threadCount());
+    for (size_t i = 0; i < visitors.size(); ++i)
+        visitors[i] = visitor->clone();
+
+    // Deal the bodies out round-robin; workers that run dry steal the rest.
+    for (size_t i = 0; i < bodies.size(); ++i)
+        pool.add(bodies[i], i);
+
+    pool.run(processBody, visitors.data());
+
+    for (size_t i = 0; i < visitors.size(); ++i) {
+        visitor->merge(visitors[i]);
+        delete visitors[i];
+    }
+}
+
+} // namespace JSC
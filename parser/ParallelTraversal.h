@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ParallelTraversal_h
+#define ParallelTraversal_h
+
+#include <SyntaxTree.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// A read-only analysis that looks at one function body at a time. Each
+// worker thread gets its own clone(); when the traversal is done, every
+// clone is merge()d back into the visitor that was passed to run(). Bodies
+// are processed in no particular order, so merge() must not depend on it.
+//
+// Nested functions have bodies of their own and are handed out separately;
+// a visitor that wants per-function results should not descend into a
+// FunctionBodyType node below the one it was given.
+class FunctionBodyVisitor
+{
+public:
+    virtual ~FunctionBodyVisitor() { }
+
+    virtual FunctionBodyVisitor* clone() const = 0;
+    virtual void processFunctionBody(SyntaxTree::Node* body) = 0;
+    virtual void merge(FunctionBodyVisitor* other) = 0;
+};
+
+class ParallelTraversal
+{
+public:
+    // A thread count of 0 means one worker per online processor.
+    explicit ParallelTraversal(unsigned threadCount = 0);
+
+    void run(SyntaxTree::Node* root, FunctionBodyVisitor*);
+
+    // Appends every FunctionBodyType node below root, in source order.
+    static void collectFunctionBodies(SyntaxTree::Node* root, Vector<SyntaxTree::Node*>& bodies);
+
+private:
+    unsigned m_threadCount;
+};
+
+} // namespace JSC
+
+#endif // ParallelTraversal_h
@@ -23,18 +23,189 @@
 #include "config.h"
 #include "Parser.h"
 
+#include "ConstantFolder.h"
 #include "JSParser.h"
 #include "JSGlobalData.h"
 #include "Lexer.h"
+#include "PreparseData.h"
+#include "StructuralHasher.h"
+#include "SyntaxTree.h"
+#include "TreeDumper.h"
+#include "WorkStealingPool.h"
+#include <pthread.h>
+#include <stdio.h>
 #include <wtf/Vector.h>
 
 namespace JSC {
 
-UString Parser::createSyntaxTree(JSGlobalData* globalData, const SourceCode& source, int* errLine, UString* errMsg)
+template <typename T>
+static SyntaxTree::Node* parseWithLexer(JSGlobalData* globalData, const SourceCode& source, SyntaxTree::Program& program, FunctionBodyMode functionBodyMode, const PreparseData* preparseData, bool recover, bool recordTrivia, int& lineNumber, bool& lexError)
 {
-    m_source = &source;
-    m_sourceElements = 0;
+    Lexer<T> lexer(globalData);
+    if (recordTrivia)
+        lexer.setTrivia(&program.trivia());
+    if (preparseData) {
+        // The lexer jumps over the bodies without seeing their lines, which
+        // come from the data instead.
+        ASSERT(functionBodyMode == SkipFunctionBodies);
+        preparseData->apply(source, program.sourceLines(), program.braceMatches());
+        lexer.setCode(source, program.arena());
+        lexer.setBraceMatches(0, &program.braceMatches());
+    } else {
+        lexer.setCode(source, program.arena(), &program.sourceLines());
+        if (functionBodyMode == SkipFunctionBodies)
+            lexer.setBraceMatches(&program.braceMatches(), 0);
+    }
+
+    SyntaxTree::Node* root = jsParse(globalData, &lexer, &source, program.arena(), functionBodyMode, recover ? &program.diagnostics() : 0);
+    lineNumber = lexer.lineNumber();
+    lexError = lexer.sawError();
+    lexer.clear();
+    return root;
+}
+
+template <typename T>
+static SyntaxTree::Node* parseFunctionBodyWithLexer(JSGlobalData* globalData, const SourceCode& source, const SyntaxTree::Program& program, ParserArena& arena, TriviaTable* trivia, int& lineNumber, bool& lexError)
+{
+    // Line starts and the braces of nested bodies were recorded when the
+    // body was skipped.
+    Lexer<T> lexer(globalData);
+    lexer.setCode(source, arena);
+    lexer.setBraceMatches(0, &program.braceMatches());
+    lexer.setTrivia(trivia);
+
+    SyntaxTree::Node* body = jsParseFunctionBody(globalData, &lexer, &source, arena, SkipFunctionBodies);
+    lineNumber = lexer.lineNumber();
+    lexError = lexer.sawError();
+    lexer.clear();
+    return lexError ? 0 : body;
+}
+
+// Parses an unparsed function body of the program into the arena, and turns
+// the body node into the result. Functions nested in it are left unparsed.
+// The trivia of the body are recorded in the given table, if any.
+static bool parseUnparsedBody(JSGlobalData* globalData, const SyntaxTree::Program& program, SyntaxTree::Node* body, ParserArena& arena, TriviaTable* trivia, int& lineNumber, bool& lexError)
+{
+    ASSERT(body->isUnparsed());
+    int start = body->startOffset();
+    SourceCode source(program.source().provider(), start, body->endOffset(), program.sourceLines().lineForOffset(start));
+
+    SyntaxTree::Node* parsed;
+    if (source.provider()->is8Bit())
+        parsed = parseFunctionBodyWithLexer<LChar>(globalData, source, program, arena, trivia, lineNumber, lexError);
+    else
+        parsed = parseFunctionBodyWithLexer<UChar>(globalData, source, program, arena, trivia, lineNumber, lexError);
+    if (!parsed)
+        return false;
+
+    if (body->scope())
+        parsed->scope()->closeReplacing(*body->scope(), globalData);
+    body->replaceWith(parsed);
+    return true;
+}
+
+struct ParallelParse {
+    JSGlobalData* globalData;
+    const SyntaxTree::Program* program;
+    WorkStealingPool* pool;
+    Vector<ParserArena*> arenas;
+
+    // The failure closest to the start of the source.
+    pthread_mutex_t errorLock;
+    bool failed;
+    int errorOffset;
+    int errorLine;
+    bool lexError;
+};
+
+// Queues the outermost unparsed bodies below root, the first on the given
+// worker and each next one step workers further. Returns how many there were.
+static unsigned queueUnparsedBodies(SyntaxTree::Node* root, WorkStealingPool& pool, unsigned workerIndex, unsigned step)
+{
+    unsigned count = 0;
+    Vector<SyntaxTree::Node*, 64> stack;
+    stack.append(root);
+    while (!stack.isEmpty()) {
+        SyntaxTree::Node* n = stack.last();
+        stack.removeLast();
+        if (n->isUnparsed()) {
+            pool.add(n, workerIndex + count++ * step);
+            continue;
+        }
+        for (int i = n->childCount() - 1; i >= 0; --i) {
+            if (SyntaxTree::Node* child = n->childAt(i))
+                stack.append(child);
+        }
+    }
+    return count;
+}
+
+static void parseBodyTask(void* item, unsigned workerIndex, void* context)
+{
+    ParallelParse* parse = static_cast<ParallelParse*>(context);
+    SyntaxTree::Node* body = static_cast<SyntaxTree::Node*>(item);
+
+    int lineNumber;
+    bool lexError;
+    if (parseUnparsedBody(parse->globalData, *parse->program, body, *parse->arenas[workerIndex], 0, lineNumber, lexError)) {
+        // The bodies of nested functions become tasks in turn, so a bundle
+        // wrapped in a single function still spreads over the workers.
+        queueUnparsedBodies(body, *parse->pool, workerIndex, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&parse->errorLock);
+    if (!parse->failed || body->startOffset() < parse->errorOffset) {
+        parse->failed = true;
+        parse->errorOffset = body->startOffset();
+        parse->errorLine = lineNumber;
+        parse->lexError = lexError;
+    }
+    pthread_mutex_unlock(&parse->errorLock);
+}
+
+// Parses every function body that the first pass skipped, replacing the
+// unparsed nodes in place. Returns false if one of them does not parse.
+static bool parseFunctionBodiesInParallel(JSGlobalData* globalData, SyntaxTree::Program& program, SyntaxTree::Node* root, int& lineNumber, bool& lexError)
+{
+    WorkStealingPool pool;
+
+    ParallelParse parse;
+    parse.globalData = globalData;
+    parse.program = &program;
+    parse.pool = &pool;
+    for (unsigned i = 0; i < pool.threadCount(); ++i)
+        parse.arenas.append(&program.createWorkerArena());
+    pthread_mutex_init(&parse.errorLock, 0);
+    parse.failed = false;
+    parse.errorOffset = 0;
+    parse.errorLine = 0;
+    parse.lexError = false;
+
+    // Deal the outermost bodies out round-robin; workers that run dry steal the rest.
+    if (queueUnparsedBodies(root, pool, 0, 1))
+        pool.run(parseBodyTask, &parse);
+    pthread_mutex_destroy(&parse.errorLock);
+
+    if (!parse.failed)
+        return true;
+    lineNumber = parse.errorLine;
+    lexError = parse.lexError;
+    return false;
+}
+
+SyntaxTree::Program* Parser::parse(JSGlobalData* globalData, const SourceCode& source, unsigned options, int* errLine, UString* errMsg)
+{
+    SyntaxTree::Program* program = new SyntaxTree::Program;
+    if (!parse(globalData, source, *program, options, errLine, errMsg)) {
+        delete program;
+        return 0;
+    }
+    return program;
+}
 
+bool Parser::parse(JSGlobalData* globalData, const SourceCode& source, SyntaxTree::Program& program, unsigned options, int* errLine, UString* errMsg, const PreparseData* preparseData)
+{
     int defaultErrLine;
     UString defaultErrMsg;
 
@@ -46,25 +217,339 @@ UString Parser::createSyntaxTree(JSGlobalData* globalData, const SourceCode& sou
     *errLine = -1;
     *errMsg = UString();
 
-    Lexer& lexer = *globalData->lexer;
-    lexer.setCode(*m_source, m_arena);
+    program.reset();
+    program.setSource(source);
+    bool recover = options & RecoverFromErrors;
+    bool parallel = (options & ParallelFunctionBodies) && !(options & (LazyFunctionBodies | RecoverFromErrors | RecordTrivia));
+    FunctionBodyMode functionBodyMode = (options & LazyFunctionBodies) || parallel ? SkipFunctionBodies : ParseFunctionBodies;
+    if (functionBodyMode != SkipFunctionBodies || (preparseData && !preparseData->matches(source)))
+        preparseData = 0;
 
-    UString tree = jsCreateSyntaxTree(globalData, m_source);
-    int lineNumber = lexer.lineNumber();
-    bool lexError = lexer.sawError();
-    lexer.clear();
+    // Latin-1 sources are lexed as they are, without widening to UTF-16.
+    int lineNumber;
+    bool lexError;
+    SyntaxTree::Node* root;
+    if (source.provider()->is8Bit())
+        root = parseWithLexer<LChar>(globalData, source, program, functionBodyMode, preparseData, recover, options & RecordTrivia, lineNumber, lexError);
+    else
+        root = parseWithLexer<UChar>(globalData, source, program, functionBodyMode, preparseData, recover, options & RecordTrivia, lineNumber, lexError);
+
+    if (parallel && root && !lexError && !parseFunctionBodiesInParallel(globalData, program, root, lineNumber, lexError))
+        root = 0;
+
+    if (recover) {
+        // Lexer errors were reported and skipped like the others.
+        ASSERT(root);
+        lexError = false;
+        if (!program.diagnostics().isEmpty()) {
+            *errLine = program.diagnostics().first().line;
+            *errMsg = diagnosticMessage(program.diagnostics().first());
+        }
+    }
 
     if (lexError) {
         *errLine = lineNumber;
         *errMsg = "Parse error";
         printf("Error in line %d\n", lineNumber);
-        m_sourceElements = 0;
     }
 
-    m_arena.reset();
+    if (!root || lexError) {
+        program.reset();
+        return false;
+    }
+
+    program.setRoot(root);
+
+    if (options & FoldConstants) {
+        ConstantFolder folder(globalData, program.arena().identifierArena());
+        root->apply(&folder);
+    }
+
+    StructuralHasher hasher;
+    root->apply(&hasher);
+
+    return true;
+}
+
+// Rehashes the nodes on the path from n down to body, deepest first, after
+// the hash of body changed. Returns whether body is below n.
+static bool rehashAncestors(SyntaxTree::Node* n, const SyntaxTree::Node* body)
+{
+    if (n == body)
+        return true;
+
+    for (int i = 0; i < n->childCount(); ++i) {
+        SyntaxTree::Node* child = n->childAt(i);
+        if (!child || (child->hasRange() && (child->startOffset() > body->startOffset() || child->endOffset() < body->endOffset())))
+            continue;
+        if (rehashAncestors(child, body)) {
+            StructuralHasher::rehash(n);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Parser::parseFunctionBody(JSGlobalData* globalData, SyntaxTree::Program& program, SyntaxTree::Node* body, unsigned options)
+{
+    ASSERT(body->type() == SyntaxTree::Node::FunctionBodyType);
+    if (!body->isUnparsed())
+        return true;
+
+    int lineNumber;
+    bool lexError;
+    TriviaTable trivia;
+    if (!parseUnparsedBody(globalData, program, body, program.arena(), (options & RecordTrivia) ? &trivia : 0, lineNumber, lexError))
+        return false;
+    if (options & RecordTrivia)
+        program.trivia().splice(body->startOffset(), body->endOffset(), 0, trivia);
+
+    if (options & FoldConstants) {
+        ConstantFolder folder(globalData, program.arena().identifierArena());
+        body->apply(&folder);
+    }
+
+    StructuralHasher hasher;
+    body->apply(&hasher);
+    // The enclosing nodes were hashed with the unparsed body.
+    rehashAncestors(program.root(), body);
+    return true;
+}
+
+// Each incremental reparse keeps a source alive, as well as the nodes of the
+// body it replaces. After this many the whole source is parsed again, which
+// lets go of them.
+static const unsigned maxIncrementalReparses = 32;
+
+static void appendCharacters(Vector<UChar>& characters, SourceProvider* provider, int start, int end)
+{
+    if (provider->is8Bit())
+        characters.append(provider->data8() + start, end - start);
+    else
+        characters.append(provider->data() + start, end - start);
+}
+
+// The source with the edits applied, widened to UTF-16.
+static UString applyEdits(const SourceCode& source, const Vector<SourceEdit>& edits)
+{
+    SourceProvider* provider = source.provider();
+    int length = provider->length();
+
+    Vector<UChar> characters;
+    int offset = 0;
+    for (size_t i = 0; i < edits.size(); ++i) {
+        const SourceEdit& edit = edits[i];
+        ASSERT(edit.offset >= offset && edit.removedLength >= 0 && edit.offset + edit.removedLength <= length);
+        appendCharacters(characters, provider, offset, edit.offset);
+        characters.append(edit.insertedText.characters(), edit.insertedText.length());
+        offset = edit.offset + edit.removedLength;
+    }
+    appendCharacters(characters, provider, offset, length);
+    return UString(characters.data(), characters.size());
+}
+
+// Collects, outermost first, the function bodies below n that hold the
+// characters from start to end with their braces left out.
+static bool findEnclosingBodies(SyntaxTree::Node* n, int start, int end, Vector<SyntaxTree::Node*, 16>& bodies)
+{
+    bool isBody = n->type() == SyntaxTree::Node::FunctionBodyType;
+    if (isBody) {
+        if (start <= n->startOffset() || end >= n->endOffset())
+            return false;
+        bodies.append(n);
+    }
+
+    for (int i = 0; i < n->childCount(); ++i) {
+        SyntaxTree::Node* child = n->childAt(i);
+        if (!child || (child->hasRange() && (child->endOffset() <= start || child->startOffset() >= end)))
+            continue;
+        if (findEnclosingBodies(child, start, end, bodies))
+            return true;
+    }
+    return isBody;
+}
+
+// Moves the nodes at or after offset from by delta, leaving the reparsed body
+// alone, and rehashes the nodes whose hash changed with it: its ancestors,
+// and unparsed bodies, which are hashed by position, with their ancestors.
+// Subtrees with a range that ends before from are left as they are.
+static bool shiftOffsets(SyntaxTree::Node* n, const SyntaxTree::Node* body, int from, int delta)
+{
+    if (n == body)
+        return true;
+
+    bool changed = false;
+    for (int i = 0; i < n->childCount(); ++i) {
+        SyntaxTree::Node* child = n->childAt(i);
+        if (!child || (child->hasRange() && child->endOffset() < from))
+            continue;
+        if (shiftOffsets(child, body, from, delta))
+            changed = true;
+    }
+
+    int start = n->startOffset();
+    int end = n->endOffset();
+    if (delta && end >= from) {
+        n->setRange(start >= from ? start + delta : start, end + delta);
+        if (n->isUnparsed())
+            changed = true;
+    }
+
+    if (changed)
+        StructuralHasher::rehash(n);
+    return changed;
+}
+
+// Parses a function body of the program again from the edited source, in
+// which it ends delta characters further on, and fits the result into the
+// tree. Returns false, changing nothing, if the body does not parse.
+static bool reparseBody(JSGlobalData* globalData, SyntaxTree::Program& program, const SourceCode& source, SyntaxTree::Node* body, int delta, unsigned options)
+{
+    SourceLines& sourceLines = program.sourceLines();
+    int start = body->startOffset();
+    int end = body->endOffset();
+    SourceCode bodySource(source.provider(), start, end + delta, sourceLines.lineForOffset(start));
+
+    // Edited sources are always UTF-16.
+    SourceLines lines;
+    BraceMatches braces;
+    TriviaTable trivia;
+    FunctionBodyMode functionBodyMode = (options & Parser::LazyFunctionBodies) ? SkipFunctionBodies : ParseFunctionBodies;
+    Lexer<UChar> lexer(globalData);
+    lexer.setCode(bodySource, program.arena(), &lines);
+    if (functionBodyMode == SkipFunctionBodies)
+        lexer.setBraceMatches(&braces, 0);
+    if (options & Parser::RecordTrivia)
+        lexer.setTrivia(&trivia);
+    SyntaxTree::Node* parsed = jsParseFunctionBody(globalData, &lexer, &bodySource, program.arena(), functionBodyMode);
+    bool lexError = lexer.sawError();
+    lexer.clear();
+    if (!parsed || lexError)
+        return false;
+
+    int lineDelta = (lines.lastLine() - lines.firstLine()) - (sourceLines.lineForOffset(end - 1) - sourceLines.lineForOffset(start));
+    sourceLines.splice(start, end, delta, lines);
+    program.braceMatches().splice(start + 1, end - 1, delta, lineDelta, braces);
+    if (options & Parser::RecordTrivia)
+        program.trivia().splice(start, end, delta, trivia);
+
+    if (body->scope())
+        parsed->scope()->closeReplacing(*body->scope(), globalData);
+    body->replaceWith(parsed);
+    if (options & Parser::FoldConstants) {
+        ConstantFolder folder(globalData, program.arena().identifierArena());
+        body->apply(&folder);
+    }
+    StructuralHasher hasher;
+    body->apply(&hasher);
+
+    // The old range still leads the walk to the body.
+    shiftOffsets(program.root(), body, end, delta);
+    body->setRange(start, end + delta);
+    program.retainSource(program.source());
+    program.setSource(source);
+    return true;
+}
+
+SyntaxTree::Program* Parser::reparse(JSGlobalData* globalData, SyntaxTree::Program* program, const Vector<SourceEdit>& edits, unsigned options, int* errLine, UString* errMsg)
+{
+    if (errLine)
+        *errLine = -1;
+    if (errMsg)
+        *errMsg = UString();
+    if (edits.isEmpty())
+        return program;
+
+    const SourceCode& oldSource = program->source();
+    SourceCode source(new UStringSourceProvider(applyEdits(oldSource, edits), oldSource.provider()->url()));
+    int changeStart = edits.first().offset;
+    int changeEnd = edits.last().offset + edits.last().removedLength;
+    int delta = source.length() - oldSource.length();
 
-    return tree;
+    // Where a statement ends depends on what follows it, through automatic
+    // semicolons, so the smallest part of the tree that can be parsed on its
+    // own is a function body, delimited by its braces. If the innermost one
+    // around the edits does not parse, the edits may have moved its end; try
+    // the bodies around it.
+    // A statement left out by a recovering parse may be anywhere.
+    Vector<SyntaxTree::Node*, 16> bodies;
+    if (program->diagnostics().isEmpty() && program->retainedSourceCount() < maxIncrementalReparses && findEnclosingBodies(program->root(), changeStart, changeEnd, bodies)) {
+        for (size_t i = bodies.size(); i--;) {
+            if (reparseBody(globalData, *program, source, bodies[i], delta, options))
+                return program;
+        }
+        // The failed attempts interned identifiers from the edited source.
+        program->retainSource(source);
+    }
+
+    SyntaxTree::Program* reparsed = parse(globalData, source, options, errLine, errMsg);
+    if (!reparsed)
+        return 0;
+    delete program;
+    return reparsed;
+}
+
+UString Parser::createSyntaxTree(JSGlobalData* globalData, const SourceCode& source, unsigned options, int* errLine, UString* errMsg, Vector<ParseDiagnostic>* diagnostics)
+{
+    SyntaxTree::Program* program = parse(globalData, source, options, errLine, errMsg);
+    if (!program)
+        return UString();
+    if (diagnostics)
+        diagnostics->append(program->diagnostics());
+
+    JSONTreeDumper dumper;
+    dumper.start();
+    program->root()->apply(&dumper);
+    dumper.finish();
+    delete program;
+
+    return dumper.result();
 }
 
+static const char* tokenDescription(JSTokenType token)
+{
+    switch (token) {
+    case OPENBRACE:
+        return "'{'";
+    case CLOSEBRACE:
+        return "'}'";
+    case OPENPAREN:
+        return "'('";
+    case CLOSEPAREN:
+        return "')'";
+    case OPENBRACKET:
+        return "'['";
+    case CLOSEBRACKET:
+        return "']'";
+    case COLON:
+        return "':'";
+    case SEMICOLON:
+        return "';'";
+    case INTOKEN:
+        return "'in'";
+    case WHILE:
+        return "'while'";
+    case IDENT:
+        return "an identifier";
+    case EOFTOK:
+        return "end of input";
+    default:
+        return 0;
+    }
+}
+
+UString Parser::diagnosticMessage(const ParseDiagnostic& diagnostic)
+{
+    if (diagnostic.found == ERRORTOK)
+        return "Invalid token";
+    if (const char* expected = tokenDescription(diagnostic.expected)) {
+        char message[32];
+        snprintf(message, sizeof(message), "Expected %s", expected);
+        return message;
+    }
+    if (diagnostic.found == EOFTOK)
+        return "Unexpected end of input";
+    return "Unexpected token";
+}
 
 } // namespace JSC
@@ -29,33 +29,113 @@
 #include "SourceProvider.h"
 #include "UString.h"
 #include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
 
 namespace JSC {
 
     class FunctionBodyNode;
+    class PreparseData;
+
+    namespace SyntaxTree {
+        class Node;
+        class Program;
+    }
     
+    // Replaces the removedLength characters at offset with insertedText.
+    struct SourceEdit {
+        SourceEdit(int offset, int removedLength, const UString& insertedText)
+            : offset(offset)
+            , removedLength(removedLength)
+            , insertedText(insertedText)
+        {
+        }
+
+        int offset;
+        int removedLength;
+        UString insertedText;
+    };
+
     class ProgramNode;
     class ScopeNode;
     class SourceElements;
 
+    // Parser keeps no state between or during parses: every parse owns its
+    // lexer, arena and tree, so one Parser may be used from several threads.
     class Parser : public Noncopyable {
     public:
 
-        UString createSyntaxTree(JSGlobalData* globalData, const SourceCode& m_source, int* errLine = 0, UString* errMsg = 0);
+        enum ParseOption {
+            NoParseOptions = 0,
+            // Fold operations on literals, see ConstantFolder.
+            FoldConstants = 1 << 0,
+            // Skip function bodies, leaving unparsed nodes that parseFunctionBody()
+            // fills in on demand. Errors inside skipped bodies are not reported.
+            LazyFunctionBodies = 1 << 1,
+            // Skip function bodies first, then parse them on one thread per
+            // processor, each with its own arena. Ignored with LazyFunctionBodies,
+            // RecoverFromErrors or RecordTrivia.
+            ParallelFunctionBodies = 1 << 2,
+            // Go on after a syntax error at the next statement, leaving out the
+            // one the error was found in, and list the errors in the program's
+            // diagnostics(). A tree is returned whatever the source.
+            RecoverFromErrors = 1 << 3,
+            // Record comments and the trivia before every token in the
+            // program's trivia(). Those of lazily skipped bodies are added
+            // when parseFunctionBody() or reparse() is given the option too.
+            RecordTrivia = 1 << 4
+        };
+
+        // Parses the source and returns the resulting tree, or 0 on error.
+        // The caller owns the returned program. Its identifiers may refer to the
+        // characters of the source, which must outlive it. With RecoverFromErrors
+        // errLine and errMsg describe the first error, if any.
+        SyntaxTree::Program* parse(JSGlobalData* globalData, const SourceCode& source, unsigned options = NoParseOptions, int* errLine = 0, UString* errMsg = 0);
 
-        ParserArena& arena() { return m_arena; }
+        // Like parse(), but parses into a program the caller already has,
+        // which is reset first. The program keeps the memory of its earlier
+        // parses, so once it has grown to fit, parsing a similar source into
+        // it again does not allocate, apart from the threads started for
+        // ParallelFunctionBodies and the message of an error. Returns false
+        // on error, leaving the program empty.
+        //
+        // With LazyFunctionBodies or ParallelFunctionBodies, preparse data
+        // taken from an earlier parse of the same characters saves pairing up
+        // the braces of the skipped bodies. Data that does not match the
+        // source is ignored.
+        bool parse(JSGlobalData* globalData, const SourceCode& source, SyntaxTree::Program& program, unsigned options = NoParseOptions, int* errLine = 0, UString* errMsg = 0, const PreparseData* preparseData = 0);
+
+        // Like parse(), but gives the tree as JSON. The errors found with
+        // RecoverFromErrors are appended to diagnostics, if given.
+        UString createSyntaxTree(JSGlobalData* globalData, const SourceCode& m_source, unsigned options = NoParseOptions, int* errLine = 0, UString* errMsg = 0, Vector<ParseDiagnostic>* diagnostics = 0);
+
+        // Describes an error in words, such as "Expected ')'".
+        static UString diagnosticMessage(const ParseDiagnostic&);
+
+        // Parses an unparsed function body of the program in place. Functions
+        // nested in it are skipped in turn. Returns false on a syntax error, in
+        // which case the body is left unparsed. The enclosing nodes are rehashed.
+        bool parseFunctionBody(JSGlobalData* globalData, SyntaxTree::Program& program, SyntaxTree::Node* body, unsigned options = NoParseOptions);
+
+        // Applies edits to the source of a program and brings the tree up to
+        // date. The edits are given in offsets of the current source, in order
+        // and without overlapping. When they all fall inside one function body
+        // and leave its braces alone, only that body is parsed again and the
+        // rest of the tree is kept, with its offsets moved and the hashes above
+        // the body recomputed. Otherwise the whole source is parsed again. With
+        // LazyFunctionBodies the edited body comes back parsed, with the
+        // functions nested in it skipped.
+        //
+        // Returns the updated program, which may be the same object, and which
+        // takes the place of the one passed in. On a syntax error returns 0 and
+        // leaves the program as it was. Options are those of the original parse.
+        // A program with diagnostics is always parsed again as a whole.
+        SyntaxTree::Program* reparse(JSGlobalData* globalData, SyntaxTree::Program* program, const Vector<SourceEdit>& edits, unsigned options = NoParseOptions, int* errLine = 0, UString* errMsg = 0);
 
     private:
 
         // Used to determine type of error to report.
         bool isFunctionBodyNode(ScopeNode*) { return false; }
         bool isFunctionBodyNode(FunctionBodyNode*) { return true; }
-
-        ParserArena m_arena;
-        const SourceCode* m_source;
-        SourceElements* m_sourceElements;
-        int m_lastLine;
-        int m_numConstants;
     };
 
     class PropertyNode {
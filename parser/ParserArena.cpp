@@ -28,27 +28,62 @@
 
 namespace JSC {
 
-ParserArena::ParserArena()
-    : m_freeableMemory(0)
-    , m_freeablePoolEnd(0)
-    , m_identifierArena(new IdentifierArena)
+IdentifierArena::IdentifierArena(ParserArena& arena)
+    : m_arena(arena)
+    , m_lookupCount(0)
 {
+    resetTable(initialTableSize);
 }
 
-inline void* ParserArena::freeablePool()
+void IdentifierArena::resetTable(size_t size)
 {
-    ASSERT(m_freeablePoolEnd);
-    return m_freeablePoolEnd - freeablePoolSize;
+    ASSERT(!(size & (size - 1)));
+    Entry empty = { 0, 0 };
+    m_table.fill(empty, size);
+    m_tableMask = size - 1;
 }
 
-inline void ParserArena::deallocateObjects()
+void IdentifierArena::expandTable()
+{
+    Vector<Entry> oldTable;
+    oldTable.swap(m_table);
+    resetTable(oldTable.size() * 2);
+
+    for (size_t i = 0; i < oldTable.size(); ++i) {
+        const Entry& entry = oldTable[i];
+        if (!entry.identifier)
+            continue;
+        unsigned index = entry.hash & m_tableMask;
+        while (m_table[index].identifier)
+            index = (index + 1) & m_tableMask;
+        m_table[index] = entry;
+    }
+}
+
+void IdentifierArena::clear()
 {
-    if (m_freeablePoolEnd)
-        free(freeablePool());
+    // The identifiers themselves go with the memory of the ParserArena.
+    m_identifiers.shrink(0);
+    resetTable(m_table.size());
+    m_lookupCount = 0;
+}
+
+ParserArena::ParserArena()
+    : m_freeableMemory(0)
+    , m_freeablePoolEnd(0)
+    , m_identifierArena(new IdentifierArena(*this))
+    , m_freeablePoolCount(0)
+    , m_largeBlockBytes(0)
+{
+}
 
-    size_t size = m_freeablePools.size();
-    for (size_t i = 0; i < size; ++i)
+inline void ParserArena::deallocateObjects()
+{
+    for (size_t i = 0; i < m_freeablePools.size(); ++i)
         free(m_freeablePools[i]);
+
+    for (size_t i = 0; i < m_largeBlocks.size(); ++i)
+        free(m_largeBlocks[i].memory);
 }
 
 ParserArena::~ParserArena()
@@ -57,30 +92,58 @@ ParserArena::~ParserArena()
     delete m_identifierArena;
 }
 
-
 void ParserArena::reset()
 {
-    // Since this code path is used only when parsing fails, it's not bothering to reuse
-    // any of the memory the arena allocated. We could improve that later if we want to
-    // efficiently reuse the same arena.
-
-    deallocateObjects();
-
     m_freeableMemory = 0;
     m_freeablePoolEnd = 0;
+    m_freeablePoolCount = 0;
+
+    for (size_t i = 0; i < m_largeBlocks.size(); ++i)
+        m_largeBlocks[i].inUse = false;
+    m_largeBlockBytes = 0;
+
     m_identifierArena->clear();
-    m_freeablePools.clear();
+}
+
+void* ParserArena::allocateFreeableSlowCase(size_t alignedSize)
+{
+    if (alignedSize > maxPooledSize)
+        return allocateLargeBlock(alignedSize);
+
+    allocateFreeablePool();
+    void* block = m_freeableMemory;
+    m_freeableMemory += alignedSize;
+    return block;
+}
+
+void* ParserArena::allocateLargeBlock(size_t alignedSize)
+{
+    // Take the smallest free block that fits.
+    size_t best = m_largeBlocks.size();
+    for (size_t i = 0; i < m_largeBlocks.size(); ++i) {
+        const LargeBlock& block = m_largeBlocks[i];
+        if (!block.inUse && block.size >= alignedSize && (best == m_largeBlocks.size() || block.size < m_largeBlocks[best].size))
+            best = i;
+    }
+
+    if (best == m_largeBlocks.size()) {
+        LargeBlock block = { malloc(alignedSize), alignedSize, false };
+        m_largeBlocks.append(block);
+    }
+    LargeBlock& block = m_largeBlocks[best];
+    block.inUse = true;
+    m_largeBlockBytes += block.size;
+    return block.memory;
 }
 
 void ParserArena::allocateFreeablePool()
 {
-    if (m_freeablePoolEnd)
-        m_freeablePools.append(freeablePool());
+    if (m_freeablePoolCount == m_freeablePools.size())
+        m_freeablePools.append(malloc(freeablePoolSize));
 
-    char* pool = static_cast<char*>(malloc(freeablePoolSize));
+    char* pool = static_cast<char*>(m_freeablePools[m_freeablePoolCount++]);
     m_freeableMemory = pool;
     m_freeablePoolEnd = pool + freeablePoolSize;
-    ASSERT(freeablePool() == pool);
 }
 
 }
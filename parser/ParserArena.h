@@ -26,7 +26,7 @@
 #ifndef ParserArena_h
 #define ParserArena_h
 
-#include <wtf/SegmentedVector.h>
+#include <wtf/Vector.h>
 
 #include "UString.h"
 #include "Identifier.h"
@@ -34,31 +34,60 @@
 namespace JSC {
 
     class JSGlobalData;
+    class ParserArena;
 
+    // Interns identifiers: every occurrence of a name returns the same
+    // Identifier, so identifiers from one arena can be compared by address.
+    // Identifiers live in the ParserArena, and so do the characters of those
+    // that cannot share the characters of the source.
     class IdentifierArena {
     public:
-        ALWAYS_INLINE const Identifier& makeIdentifier(JSGlobalData*, const UChar* characters, size_t length);
+        explicit IdentifierArena(ParserArena&);
+
+        template <typename T>
+        ALWAYS_INLINE const Identifier& makeIdentifier(JSGlobalData*, const T* characters, size_t length);
+        // Like makeIdentifier(), but a new UTF-16 identifier shares the characters
+        // instead of copying them. Used for names, strings and regular expressions
+        // that are spelled out in the source without escapes, so the source must
+        // outlive the arena.
+        template <typename T>
+        ALWAYS_INLINE const Identifier& makeSourceIdentifier(JSGlobalData*, const T* characters, size_t length);
         const Identifier& makeNumericIdentifier(JSGlobalData*, double number);
 
-        void clear() { m_identifiers.clear(); }
+        // Forgets all identifiers. The table keeps its size.
+        void clear();
         bool isEmpty() const { return m_identifiers.isEmpty(); }
 
+        size_t size() const { return m_identifiers.size(); }
+        const Identifier& at(size_t index) { return *m_identifiers.at(index); }
+
+        // Number of makeIdentifier() calls, including those that found an existing name.
+        size_t lookupCount() const { return m_lookupCount; }
+        size_t tableBytes() const { return m_table.capacity() * sizeof(Entry); }
+
     private:
-        typedef SegmentedVector<Identifier, 64> IdentifierVector;
-        IdentifierVector m_identifiers;
-    };
+        struct Entry {
+            unsigned hash;
+            const Identifier* identifier;
+        };
 
-    ALWAYS_INLINE const Identifier& IdentifierArena::makeIdentifier(JSGlobalData* globalData, const UChar* characters, size_t length)
-    {
-        m_identifiers.append(Identifier(globalData, characters, length));
-        return m_identifiers.last();
-    }
+        static const size_t initialTableSize = 256;
 
-    inline const Identifier& IdentifierArena::makeNumericIdentifier(JSGlobalData* globalData, double number)
-    {
-        m_identifiers.append(Identifier(globalData, UString::number(number)));
-        return m_identifiers.last();
-    }
+        template <typename T> static ALWAYS_INLINE unsigned computeHash(const T* characters, size_t length);
+        template <typename T> static ALWAYS_INLINE bool equal(const Identifier&, const T* characters, size_t length);
+        template <typename T> ALWAYS_INLINE const Identifier& intern(const T* characters, size_t length, UString::CharacterOwnership);
+        template <typename T> ALWAYS_INLINE const UChar* copyCharacters(const T* characters, size_t length);
+        ALWAYS_INLINE const UChar* storeCharacters(const LChar* characters, size_t length, UString::CharacterOwnership);
+        ALWAYS_INLINE const UChar* storeCharacters(const UChar* characters, size_t length, UString::CharacterOwnership);
+        void resetTable(size_t size);
+        void expandTable();
+
+        ParserArena& m_arena;
+        Vector<const Identifier*> m_identifiers;
+        Vector<Entry> m_table;
+        unsigned m_tableMask;
+        size_t m_lookupCount;
+    };
 
     class ParserArena : Noncopyable {
     public:
@@ -68,23 +97,41 @@ namespace JSC {
         void* allocateFreeable(size_t size)
         {
             ASSERT(size);
-            ASSERT(size <= freeablePoolSize);
             size_t alignedSize = alignSize(size);
-            ASSERT(alignedSize <= freeablePoolSize);
             if (UNLIKELY(static_cast<size_t>(m_freeablePoolEnd - m_freeableMemory) < alignedSize))
-                allocateFreeablePool();
+                return allocateFreeableSlowCase(alignedSize);
             void* block = m_freeableMemory;
             m_freeableMemory += alignedSize;
             return block;
         }
 
+        // Lets go of everything allocated so far, keeping the memory for
+        // what is allocated next. Once the arena has grown to fit a parse,
+        // parsing a similar source into it again allocates nothing.
         void reset();
 
         IdentifierArena& identifierArena() { return *m_identifierArena; }
 
+        // Scratch buffers the lexer borrows for the length of a parse.
+        Vector<char>& lexerBuffer8() { return m_lexerBuffer8; }
+        Vector<UChar>& lexerBuffer16() { return m_lexerBuffer16; }
+
+        size_t poolCount() const { return m_freeablePoolCount; }
+        size_t allocatedBytes() const { return poolCount() * freeablePoolSize + m_largeBlockBytes; }
+        size_t unusedBytes() const { return m_freeablePoolEnd - m_freeableMemory; }
+
     private:
         static const size_t freeablePoolSize = 8000;
 
+        // Blocks larger than this get a block of their own.
+        static const size_t maxPooledSize = freeablePoolSize / 4;
+
+        struct LargeBlock {
+            void* memory;
+            size_t size;
+            bool inUse;
+        };
+
         static size_t alignSize(size_t size)
         {
             // This defines a type which holds an unsigned integer and is the same
@@ -94,7 +141,8 @@ namespace JSC {
             return (size + sizeof(AllocAlignmentInteger) - 1) & ~(sizeof(AllocAlignmentInteger) - 1);
         }
 
-        void* freeablePool();
+        void* allocateFreeableSlowCase(size_t alignedSize);
+        void* allocateLargeBlock(size_t alignedSize);
         void allocateFreeablePool();
         void deallocateObjects();
 
@@ -102,9 +150,202 @@ namespace JSC {
         char* m_freeablePoolEnd;
 
         IdentifierArena* m_identifierArena;
+
+        // All pools and large blocks allocated so far. Those not in use were
+        // let go of by reset() and wait to be used again.
         Vector<void*> m_freeablePools;
+        size_t m_freeablePoolCount;
+        Vector<LargeBlock> m_largeBlocks;
+        size_t m_largeBlockBytes;
+
+        Vector<char> m_lexerBuffer8;
+        Vector<UChar> m_lexerBuffer16;
     };
 
+    // A growable array in a ParserArena, for the lists that make up a tree.
+    // Growing copies the elements to a block twice the size and leaves the
+    // old block to the arena. Elements are copied with memcpy and never
+    // destroyed, so T must be a plain type.
+    template <typename T>
+    class ArenaVector {
+    public:
+        ArenaVector()
+            : m_buffer(0)
+            , m_size(0)
+            , m_capacity(0)
+        {
+        }
+
+        size_t size() const { return m_size; }
+        size_t capacity() const { return m_capacity; }
+        bool isEmpty() const { return !m_size; }
+
+        T& at(size_t i)
+        {
+            ASSERT(i < m_size);
+            return m_buffer[i];
+        }
+        const T& at(size_t i) const
+        {
+            ASSERT(i < m_size);
+            return m_buffer[i];
+        }
+        T& operator[](size_t i) { return at(i); }
+        const T& operator[](size_t i) const { return at(i); }
+
+        T* begin() { return m_buffer; }
+        T* end() { return m_buffer + m_size; }
+        const T* begin() const { return m_buffer; }
+        const T* end() const { return m_buffer + m_size; }
+
+        T& last() { return at(m_size - 1); }
+        const T& last() const { return at(m_size - 1); }
+
+        void append(ParserArena& arena, const T& value)
+        {
+            if (UNLIKELY(m_size == m_capacity)) {
+                appendSlowCase(arena, value);
+                return;
+            }
+            m_buffer[m_size++] = value;
+        }
+
+        void reserveCapacity(ParserArena& arena, size_t capacity)
+        {
+            if (capacity > m_capacity)
+                reallocate(arena, capacity);
+        }
+
+        void removeLast()
+        {
+            ASSERT(m_size);
+            --m_size;
+        }
+
+        void shrink(size_t size)
+        {
+            ASSERT(size <= m_size);
+            m_size = size;
+        }
+
+        void clear() { m_size = 0; }
+
+    private:
+        static const size_t initialCapacity = 4;
+
+        void appendSlowCase(ParserArena& arena, T value)
+        {
+            reallocate(arena, m_capacity ? 2 * static_cast<size_t>(m_capacity) : initialCapacity);
+            m_buffer[m_size++] = value;
+        }
+
+        void reallocate(ParserArena& arena, size_t capacity)
+        {
+            T* buffer = static_cast<T*>(arena.allocateFreeable(capacity * sizeof(T)));
+            if (m_size)
+                memcpy(buffer, m_buffer, m_size * sizeof(T));
+            m_buffer = buffer;
+            m_capacity = capacity;
+        }
+
+        T* m_buffer;
+        unsigned m_size;
+        unsigned m_capacity;
+    };
+
+    template <typename T>
+    ALWAYS_INLINE unsigned IdentifierArena::computeHash(const T* characters, size_t length)
+    {
+        // FNV-1a
+        unsigned hash = 2166136261U;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= characters[i];
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    ALWAYS_INLINE bool IdentifierArena::equal(const Identifier& identifier, const T* characters, size_t length)
+    {
+        if (static_cast<size_t>(identifier.length()) != length)
+            return false;
+        const UChar* identifierCharacters = identifier.characters();
+        for (size_t i = 0; i < length; ++i) {
+            if (identifierCharacters[i] != characters[i])
+                return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    ALWAYS_INLINE const Identifier& IdentifierArena::makeIdentifier(JSGlobalData*, const T* characters, size_t length)
+    {
+        return intern(characters, length, UString::CopyCharacters);
+    }
+
+    template <typename T>
+    ALWAYS_INLINE const Identifier& IdentifierArena::makeSourceIdentifier(JSGlobalData*, const T* characters, size_t length)
+    {
+        return intern(characters, length, UString::ShareCharacters);
+    }
+
+    template <typename T>
+    ALWAYS_INLINE const UChar* IdentifierArena::copyCharacters(const T* characters, size_t length)
+    {
+        if (!length)
+            return 0;
+        UChar* copy = static_cast<UChar*>(m_arena.allocateFreeable(length * sizeof(UChar)));
+        for (size_t i = 0; i < length; ++i)
+            copy[i] = characters[i];
+        return copy;
+    }
+
+    // Latin1 characters are always widened into a copy.
+    ALWAYS_INLINE const UChar* IdentifierArena::storeCharacters(const LChar* characters, size_t length, UString::CharacterOwnership)
+    {
+        return copyCharacters(characters, length);
+    }
+
+    ALWAYS_INLINE const UChar* IdentifierArena::storeCharacters(const UChar* characters, size_t length, UString::CharacterOwnership ownership)
+    {
+        return ownership == UString::ShareCharacters ? characters : copyCharacters(characters, length);
+    }
+
+    template <typename T>
+    ALWAYS_INLINE const Identifier& IdentifierArena::intern(const T* characters, size_t length, UString::CharacterOwnership ownership)
+    {
+        ++m_lookupCount;
+        unsigned hash = computeHash(characters, length);
+        unsigned index = hash & m_tableMask;
+        while (const Identifier* identifier = m_table[index].identifier) {
+            if (m_table[index].hash == hash && equal(*identifier, characters, length))
+                return *identifier;
+            index = (index + 1) & m_tableMask;
+        }
+
+        // Identifiers never own their characters, as the arena does not run
+        // their destructors.
+        const UChar* stored = storeCharacters(characters, length, ownership);
+        const Identifier* identifier = new (m_arena.allocateFreeable(sizeof(Identifier))) Identifier(IdentifierCharacters<UChar>(stored, length, UString::ShareCharacters));
+        m_identifiers.append(identifier);
+        m_table[index].hash = hash;
+        m_table[index].identifier = identifier;
+
+        // Keep the load factor at or below three quarters.
+        if (m_identifiers.size() * 4 > m_table.size() * 3)
+            expandTable();
+        return *identifier;
+    }
+
+    inline const Identifier& IdentifierArena::makeNumericIdentifier(JSGlobalData* globalData, double number)
+    {
+        DtoaBuffer buffer;
+        unsigned length;
+        doubleToStringInJavaScriptFormat(number, buffer, &length);
+        return makeIdentifier(globalData, reinterpret_cast<const LChar*>(buffer), length);
+    }
+
 }
 
 #endif
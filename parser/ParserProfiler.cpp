@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "ParserProfiler.h"
+
+#if ENABLE(PARSER_PROFILING)
+
+#include <algorithm>
+#include <pthread.h>
+#include <string.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+__thread ParserProfiler::Counters* ParserProfiler::s_counters;
+
+static pthread_mutex_t countersLock = PTHREAD_MUTEX_INITIALIZER;
+static ParserProfiler::Counters* allCounters;
+
+ParserProfiler::Counters* ParserProfiler::createCounters()
+{
+    // Kept after the thread ends, so that dump() still sees what it counted.
+    Counters* counters = static_cast<Counters*>(calloc(1, sizeof(Counters)));
+    pthread_mutex_lock(&countersLock);
+    counters->next = allCounters;
+    allCounters = counters;
+    pthread_mutex_unlock(&countersLock);
+    return counters;
+}
+
+static const char* const productionNames[] = {
+#define PRODUCTION_NAME(name) "parse" #name,
+    FOR_EACH_PARSER_PRODUCTION(PRODUCTION_NAME)
+#undef PRODUCTION_NAME
+};
+
+static const struct {
+    JSTokenType type;
+    const char* name;
+} tokenNames[] = {
+    { NULLTOKEN, "NULLTOKEN" },
+    { TRUETOKEN, "TRUETOKEN" },
+    { FALSETOKEN, "FALSETOKEN" },
+    { BREAK, "BREAK" },
+    { CASE, "CASE" },
+    { DEFAULT, "DEFAULT" },
+    { FOR, "FOR" },
+    { NEW, "NEW" },
+    { VAR, "VAR" },
+    { CONSTTOKEN, "CONSTTOKEN" },
+    { CONTINUE, "CONTINUE" },
+    { FUNCTION, "FUNCTION" },
+    { RETURN, "RETURN" },
+    { IF, "IF" },
+    { THISTOKEN, "THISTOKEN" },
+    { DO, "DO" },
+    { WHILE, "WHILE" },
+    { SWITCH, "SWITCH" },
+    { WITH, "WITH" },
+    { RESERVED, "RESERVED" },
+    { THROW, "THROW" },
+    { TRY, "TRY" },
+    { CATCH, "CATCH" },
+    { FINALLY, "FINALLY" },
+    { DEBUGGER, "DEBUGGER" },
+    { ELSE, "ELSE" },
+    { OPENBRACE, "OPENBRACE" },
+    { CLOSEBRACE, "CLOSEBRACE" },
+    { OPENPAREN, "OPENPAREN" },
+    { CLOSEPAREN, "CLOSEPAREN" },
+    { OPENBRACKET, "OPENBRACKET" },
+    { CLOSEBRACKET, "CLOSEBRACKET" },
+    { COMMA, "COMMA" },
+    { QUESTION, "QUESTION" },
+    { NUMBER, "NUMBER" },
+    { IDENT, "IDENT" },
+    { STRING, "STRING" },
+    { SEMICOLON, "SEMICOLON" },
+    { COLON, "COLON" },
+    { DOT, "DOT" },
+    { ERRORTOK, "ERRORTOK" },
+    { EOFTOK, "EOFTOK" },
+    { EQUAL, "EQUAL" },
+    { PLUSEQUAL, "PLUSEQUAL" },
+    { MINUSEQUAL, "MINUSEQUAL" },
+    { MULTEQUAL, "MULTEQUAL" },
+    { DIVEQUAL, "DIVEQUAL" },
+    { LSHIFTEQUAL, "LSHIFTEQUAL" },
+    { RSHIFTEQUAL, "RSHIFTEQUAL" },
+    { URSHIFTEQUAL, "URSHIFTEQUAL" },
+    { ANDEQUAL, "ANDEQUAL" },
+    { MODEQUAL, "MODEQUAL" },
+    { XOREQUAL, "XOREQUAL" },
+    { OREQUAL, "OREQUAL" },
+    { PLUSPLUS, "PLUSPLUS" },
+    { MINUSMINUS, "MINUSMINUS" },
+    { EXCLAMATION, "EXCLAMATION" },
+    { TILDE, "TILDE" },
+    { AUTOPLUSPLUS, "AUTOPLUSPLUS" },
+    { AUTOMINUSMINUS, "AUTOMINUSMINUS" },
+    { TYPEOF, "TYPEOF" },
+    { VOIDTOKEN, "VOIDTOKEN" },
+    { DELETETOKEN, "DELETETOKEN" },
+    { OR, "OR" },
+    { AND, "AND" },
+    { BITOR, "BITOR" },
+    { BITXOR, "BITXOR" },
+    { BITAND, "BITAND" },
+    { EQEQ, "EQEQ" },
+    { NE, "NE" },
+    { STREQ, "STREQ" },
+    { STRNEQ, "STRNEQ" },
+    { LT, "LT" },
+    { GT, "GT" },
+    { LE, "LE" },
+    { GE, "GE" },
+    { INSTANCEOF, "INSTANCEOF" },
+    { INTOKEN, "INTOKEN" },
+    { LSHIFT, "LSHIFT" },
+    { RSHIFT, "RSHIFT" },
+    { URSHIFT, "URSHIFT" },
+    { PLUS, "PLUS" },
+    { MINUS, "MINUS" },
+    { TIMES, "TIMES" },
+    { DIVIDE, "DIVIDE" },
+    { MOD, "MOD" },
+};
+
+struct ProfileRow {
+    const char* name;
+    ParserProfiler::Counter counter;
+};
+
+static bool selfCyclesGreaterThan(const ProfileRow& a, const ProfileRow& b)
+{
+    return a.counter.selfCycles > b.counter.selfCycles;
+}
+
+static void addCounter(ParserProfiler::Counter& total, const ParserProfiler::Counter& counter)
+{
+    total.calls += counter.calls;
+    total.cycles += counter.cycles;
+    total.selfCycles += counter.selfCycles;
+}
+
+static void dumpRows(FILE* file, const char* title, Vector<ProfileRow>& rows, uint64_t totalCycles)
+{
+    std::sort(rows.data(), rows.data() + rows.size(), selfCyclesGreaterThan);
+    fprintf(file, "%-32s %12s %16s %16s %8s %10s\n", title, "calls", "cycles", "self cycles", "self", "per call");
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const ParserProfiler::Counter& counter = rows[i].counter;
+        fprintf(file, "%-32s %12llu %16llu %16llu %7.2f%% %10.1f\n", rows[i].name,
+            static_cast<unsigned long long>(counter.calls), static_cast<unsigned long long>(counter.cycles),
+            static_cast<unsigned long long>(counter.selfCycles), totalCycles ? 100.0 * counter.selfCycles / totalCycles : 0.0,
+            static_cast<double>(counter.selfCycles) / counter.calls);
+    }
+}
+
+void ParserProfiler::dump(FILE* file)
+{
+    Counters total;
+    memset(&total, 0, sizeof(total));
+    pthread_mutex_lock(&countersLock);
+    for (Counters* counters = allCounters; counters; counters = counters->next) {
+        for (unsigned i = 0; i < ProductionCount; ++i)
+            addCounter(total.productions[i], counters->productions[i]);
+        for (unsigned i = 0; i < tokenSlotCount; ++i)
+            addCounter(total.tokens[i], counters->tokens[i]);
+    }
+    pthread_mutex_unlock(&countersLock);
+
+    // Every cycle of a parse is the own cycles of one production or token.
+    uint64_t totalCycles = 0;
+    Vector<ProfileRow> productions;
+    for (unsigned i = 0; i < ProductionCount; ++i) {
+        if (!total.productions[i].calls)
+            continue;
+        ProfileRow row = { productionNames[i], total.productions[i] };
+        productions.append(row);
+        totalCycles += row.counter.selfCycles;
+    }
+    Vector<ProfileRow> tokens;
+    for (size_t i = 0; i < sizeof(tokenNames) / sizeof(tokenNames[0]); ++i) {
+        const Counter& counter = total.tokens[tokenSlot(tokenNames[i].type)];
+        if (!counter.calls)
+            continue;
+        ProfileRow row = { tokenNames[i].name, counter };
+        tokens.append(row);
+        totalCycles += counter.selfCycles;
+    }
+
+    dumpRows(file, "production", productions, totalCycles);
+    fprintf(file, "\n");
+    dumpRows(file, "token", tokens, totalCycles);
+}
+
+void ParserProfiler::reset()
+{
+    pthread_mutex_lock(&countersLock);
+    for (Counters* counters = allCounters; counters; counters = counters->next) {
+        Counters* next = counters->next;
+        memset(counters, 0, sizeof(Counters));
+        counters->next = next;
+    }
+    pthread_mutex_unlock(&countersLock);
+}
+
+} // namespace JSC
+
+#endif // ENABLE(PARSER_PROFILING)
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ParserProfiler_h
+#define ParserProfiler_h
+
+#include "JSParser.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <wtf/AlwaysInline.h>
+
+// With ENABLE(PARSER_PROFILING), which the PARSER_PROFILING option of the
+// build turns on, every production of JSParser counts its calls and the
+// cycles spent in it, and so does every type of token the lexer returns, so
+// that it shows which rules dominate the parse of a given style of code. The
+// counters are kept for each thread and added up by dump(). Otherwise none of
+// this is compiled in.
+
+#if ENABLE(PARSER_PROFILING)
+
+#if CPU(X86) || CPU(X86_64)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#define FOR_EACH_PARSER_PRODUCTION(macro) \
+    macro(Program) \
+    macro(StandaloneFunctionBody) \
+    macro(SourceElements) \
+    macro(Statement) \
+    macro(FunctionDeclaration) \
+    macro(VarDeclaration) \
+    macro(ConstDeclaration) \
+    macro(DoWhileStatement) \
+    macro(WhileStatement) \
+    macro(ForStatement) \
+    macro(BreakStatement) \
+    macro(ContinueStatement) \
+    macro(ReturnStatement) \
+    macro(ThrowStatement) \
+    macro(WithStatement) \
+    macro(SwitchStatement) \
+    macro(SwitchClauses) \
+    macro(SwitchDefaultClause) \
+    macro(TryStatement) \
+    macro(DebuggerStatement) \
+    macro(ExpressionStatement) \
+    macro(ExpressionOrLabelStatement) \
+    macro(IfStatement) \
+    macro(BlockStatement) \
+    macro(Expression) \
+    macro(AssignmentExpression) \
+    macro(ConditionalExpression) \
+    macro(BinaryExpression) \
+    macro(UnaryExpression) \
+    macro(MemberExpression) \
+    macro(PrimaryExpression) \
+    macro(ArrayLiteral) \
+    macro(ObjectLiteral) \
+    macro(StrictObjectLiteral) \
+    macro(Property) \
+    macro(Arguments) \
+    macro(FormalParameters) \
+    macro(FunctionInfo) \
+    macro(FunctionBody) \
+    macro(VarDeclarationList) \
+    macro(ConstDeclarationList)
+
+namespace JSC {
+
+class ParserProfiler {
+public:
+    enum Production {
+#define DECLARE_PRODUCTION(name) name##Production,
+        FOR_EACH_PARSER_PRODUCTION(DECLARE_PRODUCTION)
+#undef DECLARE_PRODUCTION
+        ProductionCount
+    };
+
+    // Token types are sparse; they are counted by their flags and low bits.
+    static const unsigned tokenSlotCount = 256;
+
+    struct Counter {
+        uint64_t calls;
+        // Cycles from entry to exit, and without those of the productions
+        // and tokens inside.
+        uint64_t cycles;
+        uint64_t selfCycles;
+    };
+
+    struct Counters {
+        Counter productions[ProductionCount];
+        Counter tokens[tokenSlotCount];
+        // Cycles of the productions and tokens inside the innermost one.
+        uint64_t innerCycles;
+        Counters* next;
+    };
+
+    // Cycles of the time stamp counter where there is one, nanoseconds
+    // elsewhere.
+    static ALWAYS_INLINE uint64_t now()
+    {
+#if CPU(X86) || CPU(X86_64)
+        return __rdtsc();
+#else
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+#endif
+    }
+
+    static ALWAYS_INLINE Counters& counters()
+    {
+        if (UNLIKELY(!s_counters))
+            s_counters = createCounters();
+        return *s_counters;
+    }
+
+    static ALWAYS_INLINE unsigned tokenSlot(JSTokenType token)
+    {
+        unsigned kind;
+        if (token & BinaryOpTokenPrecedenceMask)
+            kind = 3;
+        else if (token & UnaryOpTokenFlag)
+            kind = 2;
+        else if (token & KeywordTokenFlag)
+            kind = 1;
+        else
+            kind = 0;
+        return kind * 64 + (token & 63);
+    }
+
+    static void recordToken(JSTokenType token, uint64_t cycles)
+    {
+        Counters& all = counters();
+        Counter& counter = all.tokens[tokenSlot(token)];
+        counter.calls++;
+        counter.cycles += cycles;
+        counter.selfCycles += cycles;
+        all.innerCycles += cycles;
+    }
+
+    // Prints the counters of all threads, the productions by the cycles
+    // spent in them alone, the tokens by the cycles spent lexing them.
+    static void dump(FILE*);
+
+    // Zeroes the counters of all threads. No thread may be parsing.
+    static void reset();
+
+private:
+    static Counters* createCounters();
+
+    static __thread Counters* s_counters;
+};
+
+// Counts a call to a production and the cycles until it returns.
+class ProductionProfile {
+public:
+    explicit ALWAYS_INLINE ProductionProfile(ParserProfiler::Production production)
+        : m_production(production)
+    {
+        ParserProfiler::Counters& counters = ParserProfiler::counters();
+        m_outerInnerCycles = counters.innerCycles;
+        counters.innerCycles = 0;
+        m_start = ParserProfiler::now();
+    }
+
+    ALWAYS_INLINE ~ProductionProfile()
+    {
+        uint64_t cycles = ParserProfiler::now() - m_start;
+        ParserProfiler::Counters& counters = ParserProfiler::counters();
+        ParserProfiler::Counter& counter = counters.productions[m_production];
+        counter.calls++;
+        counter.cycles += cycles;
+        counter.selfCycles += cycles - counters.innerCycles;
+        counters.innerCycles = m_outerInnerCycles + cycles;
+    }
+
+private:
+    ParserProfiler::Production m_production;
+    uint64_t m_outerInnerCycles;
+    uint64_t m_start;
+};
+
+} // namespace JSC
+
+#define PROFILE_PRODUCTION(name) ProductionProfile productionProfile(ParserProfiler::name##Production)
+
+#else
+
+#define PROFILE_PRODUCTION(name)
+
+#endif // ENABLE(PARSER_PROFILING)
+
+#endif // ParserProfiler_h
@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "PreparseData.h"
+
+#include "BraceMatches.h"
+#include "NavigationIndex.h"
+#include "Scope.h"
+#include "SourceCode.h"
+#include "SourceLines.h"
+#include "SyntaxTree.h"
+#include <algorithm>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace JSC {
+
+// Files start with the magic, followed by numbers of seven bits to a byte:
+// the format version, the hash and length of the source, the line and
+// function counts, the line starts as the distance from the one before, and
+// for every function the distance of its start from the start of the one
+// before, then its end, open brace and close brace relative to that start,
+// its parent plus one, its counts and its flags. Eight bytes of checksum
+// over all of that end the file.
+static const char magic[4] = { 'H', 'J', 'P', 'D' };
+static const uint64_t formatVersion = 1;
+static const size_t numbersPerFunction = 9;
+static const size_t checksumSize = 8;
+
+PreparseData::PreparseData()
+    : m_sourceHash(0)
+    , m_sourceLength(0)
+{
+}
+
+void PreparseData::clear()
+{
+    m_sourceHash = 0;
+    m_sourceLength = 0;
+    m_lineStarts.clear();
+    m_functions.clear();
+}
+
+static void collectFunctions(const SyntaxTree::Node* n, int parent, int sourceStart, Vector<PreparseData::Function>& functions)
+{
+    if (NavigationIndex::isFunction(n->type())) {
+        const SyntaxTree::Node* body = n->childAt(n->childCount() - 1);
+        ASSERT(body->type() == SyntaxTree::Node::FunctionBodyType);
+
+        PreparseData::Function function;
+        function.openBrace = body->startOffset() - sourceStart;
+        function.closeBrace = body->endOffset() - 1 - sourceStart;
+        function.start = n->hasRange() ? n->startOffset() - sourceStart : function.openBrace;
+        function.end = n->hasRange() ? n->endOffset() - sourceStart : function.closeBrace + 1;
+        function.parent = parent;
+        function.parameterCount = 0;
+        function.variableCount = 0;
+        function.freeVariableCount = 0;
+        function.flags = body->isUnparsed() ? PreparseData::Unparsed : 0;
+        if (const Scope* scope = body->scope()) {
+            function.parameterCount = scope->parameters().size();
+            function.variableCount = scope->variables().size() + scope->functions().size() + scope->catchParameters().size();
+            function.freeVariableCount = scope->freeVariables().size();
+            if (scope->usesWith())
+                function.flags |= PreparseData::UsesWith;
+            if (scope->usesEval())
+                function.flags |= PreparseData::UsesEval;
+            if (scope->usesArguments())
+                function.flags |= PreparseData::UsesArguments;
+        }
+
+        parent = functions.size();
+        functions.append(function);
+    }
+
+    for (int i = 0; i < n->childCount(); ++i) {
+        if (const SyntaxTree::Node* child = n->childAt(i))
+            collectFunctions(child, parent, sourceStart, functions);
+    }
+}
+
+bool PreparseData::take(const SyntaxTree::Program& program)
+{
+    clear();
+    if (!program.root() || !program.diagnostics().isEmpty())
+        return false;
+
+    const SourceCode& source = program.source();
+    int sourceStart = source.startOffset();
+    m_sourceHash = hashSource(source);
+    m_sourceLength = source.length();
+
+    const SourceLines& lines = program.sourceLines();
+    m_lineStarts.reserveInitialCapacity(lines.lastLine() - lines.firstLine() + 1);
+    for (int line = lines.firstLine(); line <= lines.lastLine(); ++line)
+        m_lineStarts.append(lines.lineStart(line) - sourceStart);
+
+    collectFunctions(program.root(), -1, sourceStart, m_functions);
+    return true;
+}
+
+template <typename T>
+static uint64_t hashCharacters(const T* characters, size_t length)
+{
+    // 64-bit FNV-1a over the code units, so that a source hashes the same
+    // whether it is held in 8 or 16 bits.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= characters[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t PreparseData::hashSource(const SourceCode& source)
+{
+    SourceProvider* provider = source.provider();
+    if (provider->is8Bit())
+        return hashCharacters(provider->data8() + source.startOffset(), source.length());
+    return hashCharacters(provider->data() + source.startOffset(), source.length());
+}
+
+bool PreparseData::matches(const SourceCode& source) const
+{
+    return !isEmpty() && source.length() == m_sourceLength && hashSource(source) == m_sourceHash;
+}
+
+int PreparseData::lineForOffset(int offset) const
+{
+    ASSERT(!isEmpty());
+    const int* begin = m_lineStarts.data();
+    const int* end = begin + m_lineStarts.size();
+    return firstLine() + (std::upper_bound(begin + 1, end, offset) - begin) - 1;
+}
+
+void PreparseData::apply(const SourceCode& source, SourceLines& lines, BraceMatches& braces) const
+{
+    ASSERT(!isEmpty() && source.length() == m_sourceLength);
+    int sourceStart = source.startOffset();
+
+    lines.reset(source.firstLine(), sourceStart);
+    for (size_t i = 1; i < m_lineStarts.size(); ++i)
+        lines.append(sourceStart + m_lineStarts[i]);
+
+    // Functions are in the order of their opening braces, as the lexer would
+    // have recorded them.
+    braces.reset();
+    for (size_t i = 0; i < m_functions.size(); ++i) {
+        const Function& function = m_functions[i];
+        size_t index = braces.open(sourceStart + function.openBrace);
+        braces.close(index, sourceStart + function.closeBrace, lineForOffset(function.closeBrace) - lineForOffset(function.openBrace));
+    }
+}
+
+static void appendNumber(Vector<char>& data, uint64_t number)
+{
+    // The lowest seven bits first; the top bit of a byte marks that more follow.
+    while (number >= 0x80) {
+        data.append(static_cast<char>(number | 0x80));
+        number >>= 7;
+    }
+    data.append(static_cast<char>(number));
+}
+
+void PreparseData::encode(Vector<char>& data) const
+{
+    data.shrink(0);
+    data.append(magic, sizeof(magic));
+    appendNumber(data, formatVersion);
+    appendNumber(data, m_sourceHash);
+    appendNumber(data, m_sourceLength);
+    appendNumber(data, m_lineStarts.size());
+    appendNumber(data, m_functions.size());
+
+    int previous = 0;
+    for (size_t i = 0; i < m_lineStarts.size(); ++i) {
+        appendNumber(data, m_lineStarts[i] - previous);
+        previous = m_lineStarts[i];
+    }
+
+    previous = 0;
+    for (size_t i = 0; i < m_functions.size(); ++i) {
+        const Function& function = m_functions[i];
+        appendNumber(data, function.start - previous);
+        appendNumber(data, function.end - function.start);
+        appendNumber(data, function.openBrace - function.start);
+        appendNumber(data, function.closeBrace - function.start);
+        appendNumber(data, function.parent + 1);
+        appendNumber(data, function.parameterCount);
+        appendNumber(data, function.variableCount);
+        appendNumber(data, function.freeVariableCount);
+        appendNumber(data, function.flags);
+        previous = function.start;
+    }
+
+    uint64_t checksum = hashCharacters(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+    for (size_t i = 0; i < checksumSize; ++i)
+        data.append(static_cast<char>(checksum >> (8 * i)));
+}
+
+class Decoder {
+public:
+    Decoder(const char* data, size_t size)
+        : m_position(reinterpret_cast<const unsigned char*>(data))
+        , m_end(m_position + size)
+    {
+    }
+
+    size_t remaining() const { return m_end - m_position; }
+
+    bool read(uint64_t& number)
+    {
+        number = 0;
+        for (unsigned shift = 0; m_position < m_end && shift < 64; shift += 7) {
+            unsigned char byte = *m_position++;
+            number |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    // Numbers that must fit an int or an unsigned.
+    bool read(int& number)
+    {
+        uint64_t value;
+        if (!read(value) || value > INT_MAX)
+            return false;
+        number = static_cast<int>(value);
+        return true;
+    }
+
+    bool read(unsigned& number)
+    {
+        uint64_t value;
+        if (!read(value) || value > UINT_MAX)
+            return false;
+        number = static_cast<unsigned>(value);
+        return true;
+    }
+
+private:
+    const unsigned char* m_position;
+    const unsigned char* m_end;
+};
+
+// Reads the lines and functions, checking that they are in order and within
+// the source, so that data not written by encode() cannot send the lexer
+// outside the source even when its checksum holds.
+static bool decodeTables(Decoder& decoder, int sourceLength, Vector<int>& lineStarts, Vector<PreparseData::Function>& functions)
+{
+    int lineCount;
+    int functionCount;
+    if (!decoder.read(lineCount) || !decoder.read(functionCount))
+        return false;
+    // Every number takes at least a byte, which bounds the counts before
+    // anything is allocated.
+    if (!lineCount || static_cast<size_t>(lineCount) > decoder.remaining() || static_cast<size_t>(functionCount) > decoder.remaining() / numbersPerFunction)
+        return false;
+
+    lineStarts.reserveInitialCapacity(lineCount);
+    for (int i = 0, lineStart = 0; i < lineCount; ++i) {
+        int delta;
+        if (!decoder.read(delta) || (i ? !delta : delta) || delta > sourceLength - lineStart)
+            return false;
+        lineStart += delta;
+        lineStarts.append(lineStart);
+    }
+
+    functions.reserveInitialCapacity(functionCount);
+    for (int i = 0, start = 0; i < functionCount; ++i) {
+        int delta;
+        int length;
+        int openBrace;
+        int closeBrace;
+        int parent;
+        if (!decoder.read(delta) || !decoder.read(length) || !decoder.read(openBrace) || !decoder.read(closeBrace) || !decoder.read(parent))
+            return false;
+        if (delta > sourceLength - start || length > sourceLength - start - delta || openBrace >= closeBrace || closeBrace >= length || parent > i)
+            return false;
+
+        start += delta;
+        PreparseData::Function function;
+        function.start = start;
+        function.end = start + length;
+        function.openBrace = start + openBrace;
+        function.closeBrace = start + closeBrace;
+        function.parent = parent - 1;
+        if (!decoder.read(function.parameterCount) || !decoder.read(function.variableCount) || !decoder.read(function.freeVariableCount)
+            || !decoder.read(function.flags) || function.flags >= PreparseData::Unparsed << 1)
+            return false;
+
+        if (i && function.openBrace <= functions.last().openBrace)
+            return false;
+        if (function.parent >= 0) {
+            const PreparseData::Function& enclosing = functions[function.parent];
+            if (function.start <= enclosing.openBrace || function.end > enclosing.closeBrace)
+                return false;
+        }
+        functions.append(function);
+    }
+
+    return !decoder.remaining();
+}
+
+bool PreparseData::decode(const char* data, size_t size)
+{
+    clear();
+    if (size < sizeof(magic) + checksumSize || memcmp(data, magic, sizeof(magic)))
+        return false;
+
+    size -= checksumSize;
+    const unsigned char* checksumBytes = reinterpret_cast<const unsigned char*>(data + size);
+    uint64_t checksum = 0;
+    for (size_t i = 0; i < checksumSize; ++i)
+        checksum |= static_cast<uint64_t>(checksumBytes[i]) << (8 * i);
+    if (checksum != hashCharacters(reinterpret_cast<const unsigned char*>(data), size))
+        return false;
+
+    Decoder decoder(data + sizeof(magic), size - sizeof(magic));
+    uint64_t version;
+    uint64_t hash;
+    int sourceLength;
+    if (!decoder.read(version) || version != formatVersion || !decoder.read(hash) || !decoder.read(sourceLength)
+        || !decodeTables(decoder, sourceLength, m_lineStarts, m_functions)) {
+        clear();
+        return false;
+    }
+
+    m_sourceHash = hash;
+    m_sourceLength = sourceLength;
+    return true;
+}
+
+bool PreparseData::load(const char* path, const SourceCode& source)
+{
+    clear();
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    Vector<char> data;
+    char buffer[4096];
+    while (size_t count = fread(buffer, 1, sizeof(buffer), file))
+        data.append(buffer, count);
+    bool failed = ferror(file);
+    fclose(file);
+
+    if (failed || !decode(data.data(), data.size()))
+        return false;
+    if (!matches(source)) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool PreparseData::save(const char* path) const
+{
+    Vector<char> data;
+    encode(data);
+
+    static const char suffix[] = ".XXXXXX";
+    Vector<char> temporaryPath;
+    temporaryPath.append(path, strlen(path));
+    temporaryPath.append(suffix, sizeof(suffix));
+    int descriptor = mkstemp(temporaryPath.data());
+    if (descriptor == -1)
+        return false;
+
+    FILE* file = fdopen(descriptor, "wb");
+    if (!file) {
+        close(descriptor);
+        unlink(temporaryPath.data());
+        return false;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = !fclose(file) && written;
+
+    if (!written || rename(temporaryPath.data(), path)) {
+        unlink(temporaryPath.data());
+        return false;
+    }
+    return true;
+}
+
+void PreparseData::cachePath(const char* directory, const SourceCode& source, Vector<char>& path)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.preparse", static_cast<unsigned long long>(hashSource(source)));
+    path.shrink(0);
+    path.append(directory, strlen(directory));
+    path.append(name, strlen(name) + 1);
+}
+
+} // namespace JSC
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PreparseData_h
+#define PreparseData_h
+
+#include <stdint.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+class BraceMatches;
+class SourceCode;
+class SourceLines;
+
+namespace SyntaxTree {
+class Program;
+}
+
+// What a parse found out about the functions of a source, in a form small
+// enough to keep between runs: where each function and its body begin and
+// end, how many parameters it takes and a summary of its scope, together with
+// the line starts of the source. It is keyed by a hash of the characters of
+// the source, so that a copy on disk, next to the source or in a cache
+// directory, is checked against the source before it is used.
+//
+// Given to Parser::parse() with LazyFunctionBodies or ParallelFunctionBodies,
+// it stands in for the scan that pairs up the braces of skipped bodies. Tools
+// that only need an outline of the functions can read it without parsing.
+// Offsets count from the start of the source. Lines are numbered from 1, as
+// SourceLines numbers those of a source that starts on the first line.
+class PreparseData : public Noncopyable
+{
+public:
+    enum FunctionFlag {
+        UsesWith = 1 << 0,
+        UsesEval = 1 << 1,
+        UsesArguments = 1 << 2,
+        // The body was left unparsed, so its variables and the functions
+        // nested in it are unknown.
+        Unparsed = 1 << 3
+    };
+
+    struct Function {
+        // From the function keyword to the end of the closing brace.
+        int start;
+        int end;
+        int openBrace;
+        int closeBrace;
+        // The index of the enclosing function, or -1 at the top level.
+        int parent;
+        unsigned parameterCount;
+        // Names bound by var, const and function declarations and by catch
+        // clauses in the body, not counting nested functions.
+        unsigned variableCount;
+        unsigned freeVariableCount;
+        unsigned flags;
+    };
+
+    PreparseData();
+
+    // Records the functions of a parsed program, in the order of the source,
+    // replacing what was held before. A program with syntax errors leaves
+    // this empty and returns false.
+    bool take(const SyntaxTree::Program&);
+
+    void clear();
+    bool isEmpty() const { return m_lineStarts.isEmpty(); }
+
+    // Whether this was taken from a source with the same characters.
+    bool matches(const SourceCode&) const;
+    static uint64_t hashSource(const SourceCode&);
+
+    uint64_t sourceHash() const { return m_sourceHash; }
+    int sourceLength() const { return m_sourceLength; }
+    const Vector<Function>& functions() const { return m_functions; }
+    int firstLine() const { return 1; }
+    int lastLine() const { return m_lineStarts.size(); }
+    int lineStart(int line) const { return m_lineStarts[line - firstLine()]; }
+    int lineForOffset(int offset) const;
+
+    // Fills in the line starts and the braces of the function bodies that a
+    // parse skipping them would have recorded. The source must match.
+    void apply(const SourceCode&, SourceLines&, BraceMatches&) const;
+
+    // The compact form kept on disk. Decoding data of another version, cut
+    // short or otherwise damaged leaves this empty and returns false.
+    void encode(Vector<char>&) const;
+    bool decode(const char* data, size_t size);
+
+    // Reads a file written by save() and checks it against the source. A
+    // missing, damaged or stale file leaves this empty and returns false.
+    bool load(const char* path, const SourceCode&);
+
+    // Writes a temporary file and renames it to path, so that load() never
+    // sees a file that is half written.
+    bool save(const char* path) const;
+
+    // The path of the data for the source in a cache directory, named after
+    // the hash of the source, as a null-terminated string.
+    static void cachePath(const char* directory, const SourceCode&, Vector<char>& path);
+
+private:
+    uint64_t m_sourceHash;
+    int m_sourceLength;
+    Vector<int> m_lineStarts;
+    Vector<Function> m_functions;
+};
+
+} // namespace JSC
+
+#endif // PreparseData_h
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "Scope.h"
+
+#include "Identifier.h"
+#include "JSGlobalData.h"
+#include <algorithm>
+
+namespace JSC {
+
+struct NameUse {
+    const Identifier* name;
+    size_t index;
+};
+
+static bool nameUseLessThan(const NameUse& a, const NameUse& b)
+{
+    return a.name < b.name || (a.name == b.name && a.index < b.index);
+}
+
+static bool indexLessThan(const NameUse& a, const NameUse& b)
+{
+    return a.index < b.index;
+}
+
+// Sorting names by name brings the first occurrence of every name to the
+// front of its run; sorting those back by position restores the order.
+static void sortByName(ParserArena& arena, const ArenaVector<const Identifier*>& names, ArenaVector<NameUse>& uses)
+{
+    uses.reserveCapacity(arena, names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        NameUse use = { names[i], i };
+        uses.append(arena, use);
+    }
+    std::sort(uses.begin(), uses.end(), nameUseLessThan);
+}
+
+void Scope::removeDuplicates(ArenaVector<const Identifier*>& names)
+{
+    if (names.size() < 2)
+        return;
+
+    ArenaVector<NameUse> uses;
+    sortByName(m_arena, names, uses);
+    size_t count = 0;
+    for (size_t i = 0; i < uses.size(); ++i) {
+        if (!i || uses[i].name != uses[i - 1].name)
+            uses[count++] = uses[i];
+    }
+    if (count == names.size())
+        return;
+    uses.shrink(count);
+    std::sort(uses.begin(), uses.end(), indexLessThan);
+
+    for (size_t i = 0; i < count; ++i)
+        names[i] = uses[i].name;
+    names.shrink(count);
+}
+
+void Scope::appendAll(ArenaVector<const Identifier*>& names, const ArenaVector<const Identifier*>& others)
+{
+    for (size_t i = 0; i < others.size(); ++i)
+        names.append(m_arena, others[i]);
+}
+
+void Scope::close(const Identifier* functionName, const Identifier* arguments)
+{
+    m_functionName = functionName;
+    removeDuplicates(m_variables);
+    removeDuplicates(m_functions);
+    removeDuplicates(m_catchParameters);
+
+    // Scratch space comes from the arena, like the scope itself.
+    ArenaVector<const Identifier*> bound;
+    bound.reserveCapacity(m_arena, m_parameters.size() + m_variables.size() + m_functions.size() + m_catchParameters.size() + 1);
+    appendAll(bound, m_parameters);
+    appendAll(bound, m_variables);
+    appendAll(bound, m_functions);
+    appendAll(bound, m_catchParameters);
+    if (functionName)
+        bound.append(m_arena, functionName);
+    std::sort(bound.begin(), bound.end());
+
+    ArenaVector<NameUse> uses;
+    sortByName(m_arena, m_uses, uses);
+
+    size_t freeCount = 0;
+    const Identifier* previous = 0;
+    for (size_t i = 0; i < uses.size(); ++i) {
+        const Identifier* name = uses[i].name;
+        if (name == previous)
+            continue;
+        previous = name;
+        if (std::binary_search(bound.begin(), bound.end(), name))
+            continue;
+        if (name == arguments) {
+            m_usesArguments = true;
+            continue;
+        }
+        uses[freeCount++] = uses[i];
+    }
+    uses.shrink(freeCount);
+    std::sort(uses.begin(), uses.end(), indexLessThan);
+
+    m_freeVariables.clear();
+    m_freeVariables.reserveCapacity(m_arena, uses.size());
+    for (size_t i = 0; i < uses.size(); ++i)
+        m_freeVariables.append(m_arena, uses[i].name);
+    m_uses.clear();
+}
+
+void Scope::closeReplacing(const Scope& replaced, JSGlobalData* globalData)
+{
+    IdentifierArena& identifiers = m_arena.identifierArena();
+    for (size_t i = 0; i < replaced.m_parameters.size(); ++i) {
+        const Identifier* name = replaced.m_parameters[i];
+        m_parameters.append(m_arena, &identifiers.makeIdentifier(globalData, name->characters(), name->length()));
+    }
+    const Identifier* functionName = replaced.m_functionName;
+    if (functionName)
+        functionName = &identifiers.makeIdentifier(globalData, functionName->characters(), functionName->length());
+    const Identifier& arguments = globalData->propertyNames->arguments;
+    close(functionName, &identifiers.makeIdentifier(globalData, arguments.characters(), arguments.length()));
+}
+
+void Scope::addNested(const Scope& nested)
+{
+    appendAll(m_uses, nested.m_freeVariables);
+    m_usesWith = m_usesWith || nested.m_usesWith;
+    m_usesEval = m_usesEval || nested.m_usesEval;
+}
+
+} // namespace JSC
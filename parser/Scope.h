@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef Scope_h
+#define Scope_h
+
+#include "ParserArena.h"
+#include <wtf/Noncopyable.h>
+
+namespace JSC {
+
+class Identifier;
+class JSGlobalData;
+
+// The names bound and used by one function, not counting the functions nested
+// in it, or by the top level of a program. The Builder fills a scope in while
+// it parses the body and attaches it to the FunctionBody node, or to the root
+// of the program. Identifiers are those of the arena the body was parsed into,
+// so names compare by address.
+//
+// A catch parameter is taken to be bound in the whole function. Names used in
+// bodies left unparsed by a lazy or parallel parse are missing from the free
+// variables of the scopes around them, and those scopes are not brought up
+// to date when Parser::reparse() parses a body again.
+class Scope : public Noncopyable
+{
+public:
+    explicit Scope(ParserArena& arena)
+        : m_arena(arena)
+        , m_functionName(0)
+        , m_usesWith(false)
+        , m_usesEval(false)
+        , m_usesArguments(false)
+    {
+    }
+
+    void* operator new(size_t size, ParserArena& arena)
+    {
+        return arena.allocateFreeable(size);
+    }
+
+    // Parameters in order, and var, const and function declarations and
+    // catch parameters in the order of their first declaration.
+    const ArenaVector<const Identifier*>& parameters() const { return m_parameters; }
+    const ArenaVector<const Identifier*>& variables() const { return m_variables; }
+    const ArenaVector<const Identifier*>& functions() const { return m_functions; }
+    const ArenaVector<const Identifier*>& catchParameters() const { return m_catchParameters; }
+
+    // The name a function expression binds within itself, or 0.
+    const Identifier* functionName() const { return m_functionName; }
+
+    // Names used here or in nested functions that are bound by none of them,
+    // in the order of their first use. Known once the scope is closed.
+    const ArenaVector<const Identifier*>& freeVariables() const { return m_freeVariables; }
+
+    // A direct call to eval or a with statement, here or in a nested function.
+    // Either can reach the names of this scope at run time.
+    bool usesWith() const { return m_usesWith; }
+    bool usesEval() const { return m_usesEval; }
+
+    // The body of a function refers to its arguments object.
+    bool usesArguments() const { return m_usesArguments; }
+
+    void addParameter(const Identifier* name) { m_parameters.append(m_arena, name); }
+    // Names may be declared more than once; close() keeps the first.
+    void declareVariable(const Identifier* name) { m_variables.append(m_arena, name); }
+    void declareFunction(const Identifier* name) { m_functions.append(m_arena, name); }
+    void declareCatchParameter(const Identifier* name) { m_catchParameters.append(m_arena, name); }
+    void use(const Identifier* name) { m_uses.append(m_arena, name); }
+    void setUsesWith() { m_usesWith = true; }
+    void setUsesEval() { m_usesEval = true; }
+
+    // Drops repeated declarations and works out the free variables once the
+    // body is parsed. Functions bind their arguments object, given as the
+    // "arguments" identifier of the arena; the top level of a program does
+    // not, and passes 0.
+    void close(const Identifier* functionName, const Identifier* arguments);
+
+    // Closes the scope of a function body parsed on its own, with the
+    // parameters and name of the scope it replaces, interned anew.
+    void closeReplacing(const Scope& replaced, JSGlobalData*);
+
+    // Takes in the free variables and taint of a closed nested scope.
+    void addNested(const Scope&);
+
+private:
+    void removeDuplicates(ArenaVector<const Identifier*>&);
+    void appendAll(ArenaVector<const Identifier*>&, const ArenaVector<const Identifier*>&);
+
+    ParserArena& m_arena;
+    ArenaVector<const Identifier*> m_parameters;
+    ArenaVector<const Identifier*> m_variables;
+    ArenaVector<const Identifier*> m_functions;
+    ArenaVector<const Identifier*> m_catchParameters;
+    ArenaVector<const Identifier*> m_uses;
+    ArenaVector<const Identifier*> m_freeVariables;
+    const Identifier* m_functionName;
+    bool m_usesWith;
+    bool m_usesEval;
+    bool m_usesArguments;
+};
+
+} // namespace JSC
+
+#endif // Scope_h
@@ -33,25 +33,65 @@
 
 namespace JSC {
 
+    // A range of the characters of a provider, which it keeps alive.
     class SourceCode {
     public:
+        SourceCode()
+            : m_provider(0)
+            , m_startChar(0)
+            , m_endChar(0)
+            , m_firstLine(0)
+        {
+        }
+
         SourceCode(SourceProvider* provider)
             : m_provider(provider)
             , m_startChar(0)
             , m_endChar(m_provider->length())
             , m_firstLine(1)
         {
+            m_provider->ref();
+        }
+
+        // The characters from start to end, exclusive, the first of which is
+        // on line firstLine. Offsets stay relative to the whole provider.
+        SourceCode(SourceProvider* provider, int start, int end, int firstLine)
+            : m_provider(provider)
+            , m_startChar(start)
+            , m_endChar(end)
+            , m_firstLine(firstLine)
+        {
+            ASSERT(start >= 0 && start <= end && end <= m_provider->length());
+            m_provider->ref();
         }
 
-        SourceCode(SourceProvider*, int, int, int)
+        SourceCode(const SourceCode& other)
+            : m_provider(other.m_provider)
+            , m_startChar(other.m_startChar)
+            , m_endChar(other.m_endChar)
+            , m_firstLine(other.m_firstLine)
         {
-            // Not supported!
-            CRASH();
+            if (m_provider)
+                m_provider->ref();
         }
 
         ~SourceCode()
         {
-            delete m_provider;
+            if (m_provider)
+                m_provider->deref();
+        }
+
+        SourceCode& operator=(const SourceCode& other)
+        {
+            if (other.m_provider)
+                other.m_provider->ref();
+            if (m_provider)
+                m_provider->deref();
+            m_provider = other.m_provider;
+            m_startChar = other.m_startChar;
+            m_endChar = other.m_endChar;
+            m_firstLine = other.m_firstLine;
+            return *this;
         }
 
         bool isNull() const { return !m_provider; }
@@ -59,7 +99,7 @@ namespace JSC {
         SourceProvider* provider() const { return m_provider; }
         int startOffset() const { return m_startChar; }
         int endOffset() const { return m_endChar; }
-        const UChar* data() const { return m_provider->data() + m_startChar; }
+        const UChar* data() const { ASSERT(!m_provider->is8Bit()); return m_provider->data() + m_startChar; }
         int length() const { return m_endChar - m_startChar; }
 
     private:
@@ -74,6 +114,11 @@ namespace JSC {
         return SourceCode(new UStringSourceProvider(source, url));
     }
 
+    inline SourceCode makeSource(const LChar* characters, int length, const UString& url = UString())
+    {
+        return SourceCode(new Latin1SourceProvider(characters, length, url));
+    }
+
 } // namespace JSC
 
 #endif // SourceCode_h
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "SourceLines.h"
+
+#include <algorithm>
+
+namespace JSC {
+
+int SourceLines::lineForOffset(int offset) const
+{
+    // The last line that starts at or before the offset. Offsets before the
+    // first line belong to it.
+    const int* begin = m_lineStarts.data();
+    const int* end = begin + m_lineStarts.size();
+    const int* line = std::upper_bound(begin + 1, end, offset);
+    return m_firstLine + (line - begin) - 1;
+}
+
+void SourceLines::splice(int start, int end, int delta, const SourceLines& lines)
+{
+    Vector<int> lineStarts;
+    lineStarts.reserveInitialCapacity(m_lineStarts.size() + lines.m_lineStarts.size());
+
+    size_t i = 0;
+    for (; i < m_lineStarts.size() && m_lineStarts[i] <= start; ++i)
+        lineStarts.append(m_lineStarts[i]);
+    for (size_t j = 0; j < lines.m_lineStarts.size(); ++j) {
+        if (lines.m_lineStarts[j] > start)
+            lineStarts.append(lines.m_lineStarts[j]);
+    }
+    for (; i < m_lineStarts.size(); ++i) {
+        if (m_lineStarts[i] >= end)
+            lineStarts.append(m_lineStarts[i] + delta);
+    }
+
+    m_lineStarts.swap(lineStarts);
+}
+
+} // namespace JSC
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SourceLines_h
+#define SourceLines_h
+
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// The offsets at which the lines of a source begin, recorded by the lexer as
+// it consumes line terminators (LF, CR, CRLF, LFCR, U+2028 and U+2029). Maps a
+// source offset to a line and column with a binary search, so location-aware
+// tools do not have to scan the source again.
+//
+// Lines are numbered from the first line of the source code; columns count
+// characters from 0.
+class SourceLines : public Noncopyable
+{
+public:
+    SourceLines()
+        : m_firstLine(1)
+    {
+        m_lineStarts.append(0);
+    }
+
+    void reset(int firstLine, int startOffset)
+    {
+        m_firstLine = firstLine;
+        m_lineStarts.shrink(0);
+        m_lineStarts.append(startOffset);
+    }
+
+    // The parser may rewind the lexer over lines it has seen before, so only
+    // offsets past the last known line start are new.
+    void append(int lineStart)
+    {
+        if (lineStart > m_lineStarts.last())
+            m_lineStarts.append(lineStart);
+    }
+
+    int firstLine() const { return m_firstLine; }
+    int lastLine() const { return m_firstLine + m_lineStarts.size() - 1; }
+    int lineStart(int line) const { return m_lineStarts[line - m_firstLine]; }
+
+    int lineForOffset(int offset) const;
+    int columnForOffset(int offset) const { return offset - lineStart(lineForOffset(offset)); }
+
+    // After the characters from start to end were replaced by delta more
+    // characters and relexed into lines: drops the line starts recorded
+    // inside the old range, adds those of lines, and moves the later ones.
+    void splice(int start, int end, int delta, const SourceLines& lines);
+
+private:
+    int m_firstLine;
+    Vector<int> m_lineStarts;
+};
+
+} // namespace JSC
+
+#endif // SourceLines_h
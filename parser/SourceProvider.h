@@ -30,18 +30,34 @@
 #define SourceProvider_h
 
 #include <UString.h>
+#include <wtf/Noncopyable.h>
 
 namespace JSC {
 
-    class SourceProvider {
+    // Providers are reference counted by the SourceCode objects that refer to
+    // them, and deleted when the last one goes away. The count may be changed
+    // from several threads.
+    class SourceProvider : public Noncopyable {
     public:
         SourceProvider(const UString& url)
             : m_url(url)
             , m_validated(false)
+            , m_refCount(0)
         {
         }
         virtual ~SourceProvider() { }
 
+        void ref() { __sync_add_and_fetch(&m_refCount, 1); }
+        void deref()
+        {
+            if (!__sync_sub_and_fetch(&m_refCount, 1))
+                delete this;
+        }
+
+        // Providers hold either 8-bit (latin1) or UTF-16 characters. The lexer
+        // reads whichever representation is8Bit() selects, without widening.
+        virtual bool is8Bit() const { return false; }
+        virtual const LChar* data8() const { return 0; }
         virtual const UChar* data() const = 0;
         virtual int length() const = 0;
         
@@ -54,6 +70,7 @@ namespace JSC {
     private:
         UString m_url;
         bool m_validated;
+        int m_refCount;
     };
 
     class UStringSourceProvider : public SourceProvider {
@@ -70,6 +87,27 @@ namespace JSC {
     private:
         UString m_source;
     };
+
+    // Wraps latin1 characters owned by the caller, which must outlive the
+    // provider. Pure ASCII input can be lexed straight from its UTF-8 bytes.
+    class Latin1SourceProvider : public SourceProvider {
+    public:
+        Latin1SourceProvider(const LChar* characters, int length, const UString& url)
+            : SourceProvider(url)
+            , m_characters(characters)
+            , m_length(length)
+        {
+        }
+
+        bool is8Bit() const { return true; }
+        const LChar* data8() const { return m_characters; }
+        const UChar* data() const { return 0; }
+        int length() const { return m_length; }
+
+    private:
+        const LChar* m_characters;
+        int m_length;
+    };
     
 } // namespace JSC
 
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "StructuralHasher.h"
+
+#include <string.h>
+
+namespace JSC {
+
+static const uint64_t hashMultiplier = 0xc6a4a7935bd1e995ULL;
+static const uint64_t nullChildHash = 0x9e3779b97f4a7c15ULL;
+
+// One step of MurmurHash64A. The result depends on the order of the values.
+static inline uint64_t combine(uint64_t hash, uint64_t value)
+{
+    value *= hashMultiplier;
+    value ^= value >> 47;
+    value *= hashMultiplier;
+    hash ^= value;
+    hash *= hashMultiplier;
+    return hash;
+}
+
+static inline uint64_t finalize(uint64_t hash)
+{
+    hash ^= hash >> 47;
+    hash *= hashMultiplier;
+    hash ^= hash >> 47;
+    return hash;
+}
+
+uint64_t StructuralHasher::hashString(const UString& string)
+{
+    // 64-bit FNV-1a over the UTF-16 code units.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const UChar* characters = string.characters();
+    for (unsigned i = 0; i < string.length(); ++i) {
+        hash ^= characters[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return combine(hash, string.length());
+}
+
+void StructuralHasher::process(SyntaxTree::Node* n)
+{
+    for (int i = 0; i < n->childCount(); ++i) {
+        if (SyntaxTree::Node* child = n->childAt(i))
+            child->apply(this);
+    }
+    rehash(n);
+}
+
+void StructuralHasher::rehash(SyntaxTree::Node* n)
+{
+    uint64_t hash = combine(0, n->type());
+    hash = combine(hash, n->op());
+    hash = combine(hash, n->boolean());
+
+    uint64_t numberBits;
+    double number = n->number();
+    memcpy(&numberBits, &number, sizeof(numberBits));
+    hash = combine(hash, numberBits);
+
+    hash = combine(hash, hashString(n->identifier().ustring()));
+    hash = combine(hash, hashString(n->string()));
+    hash = combine(hash, n->propertyType());
+
+    // The structure of an unparsed body is unknown; its position keeps it
+    // from being taken as equal to any other.
+    if (n->isUnparsed()) {
+        hash = combine(hash, n->startOffset());
+        hash = combine(hash, n->endOffset());
+    }
+
+    int count = n->childCount();
+    hash = combine(hash, count);
+    for (int i = 0; i < count; ++i) {
+        SyntaxTree::Node* child = n->childAt(i);
+        if (!child) {
+            hash = combine(hash, nullChildHash);
+            continue;
+        }
+        hash = combine(hash, child->hash());
+    }
+
+    n->setHash(finalize(hash));
+}
+
+} // namespace JSC
@@ -27,15 +27,20 @@
 #ifndef SyntaxTree_h
 #define SyntaxTree_h
 
+#include <BraceMatches.h>
 #include <JSGlobalData.h>
+#include <JSParser.h>
 #include <Nodes.h>
+#include <Scope.h>
+#include <SourceCode.h>
+#include <SourceLines.h>
+#include <TriviaTable.h>
 #include <wtf/Vector.h>
 
 namespace JSC {
 
 class Identifier;
 class JSGlobalData;
-class Lexer;
 
 namespace SyntaxTree {
 
@@ -51,9 +56,9 @@ class Node
 {
 public:
 
-    inline void* operator new(size_t size, JSGlobalData* globalData)
+    inline void* operator new(size_t size, ParserArena& arena)
     {
-        return globalData->parser->arena().allocateFreeable(size);
+        return arena.allocateFreeable(size);
     }
 
     typedef enum {
@@ -117,6 +122,8 @@ public:
         WithStatementType
     } Type;
 
+    static const int TypeCount = WithStatementType + 1;
+
     typedef enum {
         NoOperator,
         TypeofOperator,
@@ -232,11 +239,13 @@ public:
 
     int type() const { return m_type; }
 
-    void append(Node* n) { m_children.append(n); }
+    void append(ParserArena& arena, Node* n) { m_children.append(arena, n); }
 
     int childCount() const { return m_children.size(); }
 
-    Node* childAt(int i) const { return m_children.at(i); }
+    size_t childCapacity() const { return m_children.capacity(); }
+
+    Node* childAt(int i) const { return m_children[i]; }
 
     void apply(Visitor* visitor) { visitor->process(this); }
 
@@ -244,10 +253,14 @@ public:
         : m_type(type)
         , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
@@ -255,10 +268,14 @@ public:
         : m_type(BooleanExpressionType)
         , m_operator(NoOperator)
         , m_boolean(b)
+        , m_unparsed(false)
         , m_number(0)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
@@ -266,22 +283,31 @@ public:
         : m_type(NumberExpressionType)
         , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(d)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
-    explicit Node(const UString &str)
+    // The string shares the characters of the identifier.
+    explicit Node(const Identifier& string)
         : m_type(StringExpressionType)
         , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
-        , m_string(str)
+        , m_string(string.characters(), string.length(), UString::ShareCharacters)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
@@ -289,54 +315,79 @@ public:
         : m_type(type)
         , m_operator(op)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
     explicit Node(Type type, const Identifier& id)
         : m_type(type)
+        , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
-        , m_identifier(id)
+        , m_identifier(&id)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
     explicit Node(Type type, const Identifier& pattern, const Identifier& flags)
         : m_type(type)
+        , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
-        , m_string(flags.ustring())
-        , m_identifier(pattern)
+        , m_string(flags.characters(), flags.length(), UString::ShareCharacters)
+        , m_identifier(&pattern)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
     }
 
-    explicit Node(Type type, Node* expr)
+    Node(ParserArena& arena, Type type, Node* expr)
         : m_type(type)
+        , m_operator(NoOperator)
         , m_boolean(false)
+        , m_unparsed(false)
         , m_number(0)
+        , m_identifier(0)
         , m_propertyType(PropertyNode::Constant)
         , start(0)
         , end(0)
+        , m_hash(0)
+        , m_scope(0)
     {
-        m_children.append(expr);
+        m_children.append(arena, expr);
     }
 
-    const Identifier& identifier() const { return m_identifier; }
+    // Identifiers are shared with the IdentifierArena of the program, so two
+    // nodes naming the same identifier point to the same object.
+    const Identifier& identifier() const { return m_identifier ? *m_identifier : emptyIdentifier(); }
 
     bool boolean() const { return m_boolean; }
 
+    // A function body skipped by a lazy parse. It has no children and its
+    // range covers the braces; Parser::parseFunctionBody() fills it in.
+    bool isUnparsed() const { return m_unparsed; }
+
+    void setUnparsed(bool unparsed) { m_unparsed = unparsed; }
+
     double number() const { return m_number; }
 
-    UString string() const { return m_string; }
+    const UString& string() const { return m_string; }
 
     OperatorType op() const { return m_operator; }
 
@@ -344,28 +395,165 @@ public:
 
     void setPropertyType(PropertyNode::Type type) { m_propertyType = type; }
 
+    // Turn this node into a literal in place, dropping its children. Used by
+    // passes that rewrite the tree; the source range is kept.
+    void becomeBoolean(bool b)
+    {
+        becomeLiteral(BooleanExpressionType);
+        m_boolean = b;
+    }
+
+    void becomeNumber(double d)
+    {
+        becomeLiteral(NumberExpressionType);
+        m_number = d;
+    }
+
+    // The string shares the characters of the identifier.
+    void becomeString(const Identifier& string)
+    {
+        becomeLiteral(StringExpressionType);
+        shareString(string.characters(), string.length());
+    }
+
+    // Turn this node into a copy of another one, keeping its own range. The
+    // string shares the other node's characters.
+    void replaceWith(const Node* other)
+    {
+        m_type = other->m_type;
+        m_operator = other->m_operator;
+        m_boolean = other->m_boolean;
+        m_unparsed = other->m_unparsed;
+        m_number = other->m_number;
+        shareString(other->m_string.characters(), other->m_string.length());
+        m_identifier = other->m_identifier;
+        m_propertyType = other->m_propertyType;
+        m_hash = other->m_hash;
+        m_scope = other->m_scope;
+        m_children = other->m_children;
+    }
+
+    // Structural hash of the subtree rooted at this node, filled in by
+    // StructuralHasher once the tree is complete. Source positions do not
+    // contribute, so two subtrees that differ only in layout hash the same.
+    uint64_t hash() const { return m_hash; }
+
+    void setHash(uint64_t hash) { m_hash = hash; }
+
+    // Source range of the node as character offsets, end exclusive. Nodes the
+    // parser does not track, such as argument and property lists, have an
+    // empty range.
+    int startOffset() const { return start; }
+    int endOffset() const { return end; }
+    bool hasRange() const { return end > start; }
+
+    void setRange(int startOffset, int endOffset)
+    {
+        start = startOffset;
+        end = endOffset;
+    }
+
+    // Subtree comparison that ignores source positions, as hash() does.
+    // Different hashes reject in O(1); equal ones are confirmed by comparing
+    // the subtrees, so a collision cannot make two different ones equal.
+    bool isStructurallyEqual(const Node* other) const
+    {
+        if (m_hash != other->m_hash)
+            return false;
+
+        if (m_type != other->m_type
+            || m_operator != other->m_operator
+            || m_boolean != other->m_boolean
+            || m_unparsed != other->m_unparsed
+            || memcmp(&m_number, &other->m_number, sizeof(m_number))
+            || m_string != other->m_string
+            || identifier() != other->identifier()
+            || m_propertyType != other->m_propertyType
+            || m_children.size() != other->m_children.size())
+            return false;
+
+        // An unparsed body is only equal to itself, at the same position.
+        if (m_unparsed && (start != other->start || end != other->end))
+            return false;
+
+        for (size_t i = 0; i < m_children.size(); ++i) {
+            const Node* child = m_children[i];
+            const Node* otherChild = other->m_children[i];
+            if (!child || !otherChild) {
+                if (child != otherChild)
+                    return false;
+                continue;
+            }
+            if (!child->isStructurallyEqual(otherChild))
+                return false;
+        }
+        return true;
+    }
+
+    // The names bound and used in a function body, or at the top level of a
+    // program for its root. 0 for other nodes.
+    Scope* scope() const { return m_scope; }
+    void setScope(Scope* scope) { m_scope = scope; }
+
 private:
+    static const Identifier& emptyIdentifier()
+    {
+        static const Identifier empty;
+        return empty;
+    }
+
+    // Nodes live in the arena and are never destructed, so their strings must
+    // not own characters: assigning a UString would copy them to the heap.
+    void shareString(const UChar* characters, unsigned length)
+    {
+        m_string.~UString();
+        new (&m_string) UString(characters, length, UString::ShareCharacters);
+    }
+
+    void becomeLiteral(Type type)
+    {
+        m_type = type;
+        m_operator = NoOperator;
+        m_boolean = false;
+        m_unparsed = false;
+        m_number = 0;
+        m_string = UString();
+        m_identifier = 0;
+        m_propertyType = PropertyNode::Constant;
+        m_scope = 0;
+        m_children.clear();
+    }
+
     Type m_type;
     OperatorType m_operator;
     bool m_boolean;
+    bool m_unparsed;
     double m_number;
     UString m_string;
-    Identifier m_identifier;
+    const Identifier* m_identifier;
     PropertyNode::Type m_propertyType;
     int start;
     int end;
-    WTF::Vector<Node*> m_children;
+    uint64_t m_hash;
+    Scope* m_scope;
+    ArenaVector<Node*> m_children;
 };
 
 class Builder {
 public:
-    Builder(JSGlobalData* globalData, Lexer*)
+    // Every builder fills in the scope of the function body, or the top level
+    // of the program, that it parses. The arguments identifier is the one
+    // interned in the arena, which scopes recognize by address.
+    Builder(JSGlobalData* globalData, ParserArena& arena, const Identifier* argumentsIdentifier)
         : m_globalData(globalData)
+        , m_arena(arena)
+        , m_argumentsIdentifier(argumentsIdentifier)
+        , m_scope(new (arena) Scope(arena))
     {
     }
 
     static const bool CreatesAST = true;
-    static const bool NeedsFreeVariableInfo = false;
+    static const bool NeedsFreeVariableInfo = true;
 
     typedef Builder FunctionBodyBuilder;
 
@@ -426,49 +614,49 @@ public:
 
     void addVar(const Identifier* ident, int attrs)
     {
-        // TODO: use this to hoist the variables
+        m_scope->declareVariable(ident);
     }
 
     void appendBinaryExpressionInfo(int& operandStackDepth, Expression current, int exprStart, int lhs, int rhs, bool hasAssignments)
     {
         operandStackDepth++;
-        m_binaryOperandStack.append(std::make_pair(current, BinaryOpInfo(exprStart, lhs, rhs, hasAssignments)));
+        m_binaryOperandStack.append(m_arena, std::make_pair(current, BinaryOpInfo(exprStart, lhs, rhs, hasAssignments)));
     }
 
     void appendBinaryOperation(int& operandStackDepth, int&, const BinaryOperand& lhs, const BinaryOperand& rhs)
     {
         operandStackDepth++;
-        m_binaryOperandStack.append(std::make_pair(makeBinaryNode(m_binaryOperatorStack.last().first, lhs, rhs), BinaryOpInfo(lhs.second, rhs.second)));
+        m_binaryOperandStack.append(m_arena, std::make_pair(makeBinaryNode(m_binaryOperatorStack.last().first, lhs, rhs), BinaryOpInfo(lhs.second, rhs.second)));
     }
 
     void appendUnaryToken(int& tokenStackDepth, int type, int start)
     {
         tokenStackDepth++;
-        m_unaryTokenStack.append(std::make_pair(type, start));
+        m_unaryTokenStack.append(m_arena, std::make_pair(type, start));
     }
 
     ConstDeclList appendConstDecl(ConstDeclList tail, const Identifier* name, Expression initializer)
     {
-        Node* node = new (m_globalData) Node(Node::ConstDeclarationType, *name);
-        node->append(initializer);
-        tail->append(node);
+        Node* node = new (m_arena) Node(Node::ConstDeclarationType, *name);
+        node->append(m_arena, initializer);
+        tail->append(m_arena, node);
         return tail;
     }
 
     void appendStatement(SourceElements sourceElements, Statement statement)
     {
-        sourceElements->append(statement);
+        sourceElements->append(m_arena, statement);
     }
 
     void appendToComma(Comma comma, Expression expr)
     {
-        comma->append(expr);
+        comma->append(m_arena, expr);
     }
 
     void assignmentStackAppend(int& assignmentStackDepth, Expression node, int start, int divot, int assignmentCount, Operator op)
     {
         assignmentStackDepth++;
-        m_assignmentInfoStack.append(AssignmentInfo(node, start, divot, assignmentCount, op));
+        m_assignmentInfoStack.append(m_arena, AssignmentInfo(node, start, divot, assignmentCount, op));
     }
 
     Expression combineCommaNodes(Expression list, Expression init)
@@ -476,63 +664,64 @@ public:
         if (!list)
             return init;
         if (list->type() == Node::CommaType) {
-            list->append(init);
+            list->append(m_arena, init);
             return list;
         }
-        Node* node = new (m_globalData) Node(Node::CommaType);
-        node->append(list);
-        node->append(init);
+        Node* node = new (m_arena) Node(Node::CommaType);
+        node->append(m_arena, list);
+        node->append(m_arena, init);
         return node;
     }
 
     Arguments createArguments()
     {
-        return new (m_globalData) Node(Node::ArgumentsType);
+        return new (m_arena) Node(Node::ArgumentsType);
     }
 
     Arguments createArguments(ArgumentsList argumentsList)
     {
-        return new (m_globalData) Node(Node::ArgumentsType, argumentsList);
+        return new (m_arena) Node(m_arena, Node::ArgumentsType, argumentsList);
     }
 
     ArgumentsList createArgumentsList(Expression expression)
     {
-        return new (m_globalData) Node(Node::ArgumentsListType, expression);
+        return new (m_arena) Node(m_arena, Node::ArgumentsListType, expression);
     }
 
     ArgumentsList createArgumentsList(ArgumentsList tail, Expression expression)
     {
-        tail->append(expression);
+        tail->append(m_arena, expression);
         return tail;
     }
 
     Expression createArray(int elisions)
     {
         // TODO: honor the elisions
-        Node* node = new (m_globalData) Node(Node::ArrayType);
+        Node* node = new (m_arena) Node(Node::ArrayType);
         return node;
     }
 
     Expression createArray(int elisions, ElementList elements)
     {
         // TODO: honor the elisions
-        Node* node = new (m_globalData) Node(Node::ArrayType);
-        node->append(elements);
+        Node* node = new (m_arena) Node(Node::ArrayType);
+        node->append(m_arena, elements);
         return node;
     }
 
     Expression createArray(ElementList elements)
     {
-        Node* node = new (m_globalData) Node(Node::ArrayType);
-        node->append(elements);
+        Node* node = new (m_arena) Node(Node::ArrayType);
+        node->append(m_arena, elements);
         return node;
     }
 
     Expression createAssignment(int& assignmentStackDepth, Expression rhs, int initialAssignmentCount, int currentAssignmentCount, int lastTokenEnd)
     {
-        Node* node = new (m_globalData) Node(Node::AssignmentExpressionType, Node::convertOperator(m_assignmentInfoStack.last().m_op));
-        node->append(m_assignmentInfoStack.last().m_node);
-        node->append(rhs);
+        Node* node = new (m_arena) Node(Node::AssignmentExpressionType, Node::convertOperator(m_assignmentInfoStack.last().m_op));
+        node->setRange(m_assignmentInfoStack.last().m_start, lastTokenEnd);
+        node->append(m_arena, m_assignmentInfoStack.last().m_node);
+        node->append(m_arena, rhs);
         m_assignmentInfoStack.removeLast();
         assignmentStackDepth--;
         return node;
@@ -540,194 +729,208 @@ public:
 
     Expression createAssignResolve(const Identifier& ident, Expression rhs, bool rhsHasAssignment, int start, int divot, int end)
     {
-        Expression lhs = new (m_globalData) Node(Node::IdentifierExpressionType, ident);
-        Node* node = new (m_globalData) Node(Node::AssignmentExpressionType, Node::AssignEqual);
-        node->append(lhs);
-        node->append(rhs);
+        Expression lhs = new (m_arena) Node(Node::IdentifierExpressionType, ident);
+        Node* node = new (m_arena) Node(Node::AssignmentExpressionType, Node::AssignEqual);
+        node->append(m_arena, lhs);
+        node->append(m_arena, rhs);
         return node;
     }
 
     Statement createBlockStatement(SourceElements elements, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::BlockStatementType, elements);
+        return new (m_arena) Node(m_arena, Node::BlockStatementType, elements);
     }
 
     Expression createBoolean(bool b)
     {
-        return new (m_globalData) Node(b);
+        return new (m_arena) Node(b);
     }
 
     Expression createBracketAccess(Expression base, Expression property, bool propertyHasAssignments, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::BracketAccessType);
-        node->append(base);
-        node->append(property);
+        Node* node = new (m_arena) Node(Node::BracketAccessType);
+        node->append(m_arena, base);
+        node->append(m_arena, property);
         return node;
     }
 
     Statement createBreakStatement(int eStart, int eEnd, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::BreakStatementType);
+        return new (m_arena) Node(Node::BreakStatementType);
     }
 
     Statement createBreakStatement(const Identifier* ident, int eStart, int eEnd, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::BreakStatementType, *ident);
+        return new (m_arena) Node(Node::BreakStatementType, *ident);
     }
 
     Clause createClause(Expression expr, SourceElements elements)
     {
-        Node* node = new (m_globalData) Node(Node::ClauseType, expr);
-        node->append(elements);
+        Node* node = new (m_arena) Node(m_arena, Node::ClauseType, expr);
+        node->append(m_arena, elements);
         return node;
     }
 
     ClauseList createClauseList(Clause clause)
     {
-        return new (m_globalData) Node(Node::ClauseListType, clause);
+        return new (m_arena) Node(m_arena, Node::ClauseListType, clause);
     }
 
     ClauseList createClauseList(ClauseList tail, Clause clause)
     {
-        tail->append(clause);
+        tail->append(m_arena, clause);
         return tail;
     }
 
     Comma createCommaExpr(Expression lhs, Expression rhs)
     {
-        Node* node = new (m_globalData) Node(Node::CommaType);
-        node->append(lhs);
-        node->append(rhs);
+        Node* node = new (m_arena) Node(Node::CommaType);
+        node->append(m_arena, lhs);
+        node->append(m_arena, rhs);
         return node;
     }
 
     Expression createConditionalExpr(Expression condition, Expression lhs, Expression rhs)
     {
-        Node* node = new (m_globalData) Node(Node::ConditionalExpressionType);
-        node->append(condition);
-        node->append(lhs);
-        node->append(rhs);
+        Node* node = new (m_arena) Node(Node::ConditionalExpressionType);
+        node->append(m_arena, condition);
+        node->append(m_arena, lhs);
+        node->append(m_arena, rhs);
         return node;
     }
 
     Statement createConstStatement(ConstDeclList decls, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::ConstStatementType, decls);
+        return new (m_arena) Node(m_arena, Node::ConstStatementType, decls);
     }
 
     Statement createContinueStatement(int eStart, int eEnd, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::ContinueStatementType);
+        return new (m_arena) Node(Node::ContinueStatementType);
     }
 
     Statement createContinueStatement(const Identifier* ident, int eStart, int eEnd, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::ContinueStatementType, *ident);
+        return new (m_arena) Node(Node::ContinueStatementType, *ident);
     }
 
     Statement createDebugger(int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::DebuggerType);
+        return new (m_arena) Node(Node::DebuggerType);
     }
 
     Expression createDotAccess(Expression base, const Identifier& property, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::DotAccessType, property);
-        node->append(base);
+        Node* node = new (m_arena) Node(Node::DotAccessType, property);
+        node->append(m_arena, base);
         return node;
     }
 
     Statement createDoWhileStatement(Statement statement, Expression expr, int startLine, int endLine)
     {
-        Node* node = new (m_globalData) Node(Node::DoWhileStatementType);
-        node->append(statement);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::DoWhileStatementType);
+        node->append(m_arena, statement);
+        node->append(m_arena, expr);
         return node;
     }
 
     ElementList createElementList(int elisions, Expression expression)
     {
         // FIXME: honor the elision
-        return new (m_globalData) Node(Node::ElementListType, expression);
+        return new (m_arena) Node(m_arena, Node::ElementListType, expression);
     }
 
     ElementList createElementList(ElementList tail, int elisions, Expression expression)
     {
         // FIXME: honor the elision
-        tail->append(expression);
+        tail->append(m_arena, expression);
         return tail;
     }
 
     Statement createEmptyStatement()
     {
-        return new (m_globalData) Node(Node::EmptyStatementType);
+        return new (m_arena) Node(Node::EmptyStatementType);
     }
 
     Statement createExprStatement(Expression expr, int start, int end)
     {
-        Node* node = new (m_globalData) Node(Node::ExpressionStatementType);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::ExpressionStatementType);
+        node->append(m_arena, expr);
         return node;
     }
 
     Statement createForLoop(Expression initializer, Expression condition, Expression iter, Statement statements, bool b, int start, int end)
     {
-        Node *node = new (m_globalData) Node(Node::ForLoopType);
-        node->append(initializer);
-        node->append(condition);
-        node->append(iter);
-        node->append(statements);
+        Node *node = new (m_arena) Node(Node::ForLoopType);
+        node->append(m_arena, initializer);
+        node->append(m_arena, condition);
+        node->append(m_arena, iter);
+        node->append(m_arena, statements);
         return node;
     }
 
     Statement createForInLoop(const Identifier* ident, Expression initializer, Expression iter, Statement statements, int start, int divot, int end, int initStart, int initEnd, int startLine, int endLine)
     {
-        Node *node = new (m_globalData) Node(Node::ForInLoopType, *ident);
-        node->append(initializer);
-        node->append(iter);
-        node->append(statements);
+        Node *node = new (m_arena) Node(Node::ForInLoopType, *ident);
+        node->append(m_arena, initializer);
+        node->append(m_arena, iter);
+        node->append(m_arena, statements);
         return node;
     }
 
     Statement createForInLoop(Expression lhs, Expression iter, Statement statements, int eStart, int eDivot, int eEnd, int start, int end)
     {
-        Node *node = new (m_globalData) Node(Node::ForInLoopType);
-        node->append(lhs);
-        node->append(iter);
-        node->append(statements);
+        Node *node = new (m_arena) Node(Node::ForInLoopType);
+        node->append(m_arena, lhs);
+        node->append(m_arena, iter);
+        node->append(m_arena, statements);
         return node;
     }
 
     FormalParameterList createFormalParameterList(const Identifier& identifier)
     {
-        return new (m_globalData) Node(Node::FormalParameterListType, identifier);
+        return new (m_arena) Node(Node::FormalParameterListType, identifier);
     }
 
     FormalParameterList createFormalParameterList(FormalParameterList tail, const Identifier& identifier)
     {
-        Node* node = new (m_globalData) Node(Node::FormalParameterListType, identifier);
-        tail->append(node);
+        Node* node = new (m_arena) Node(Node::FormalParameterListType, identifier);
+        tail->append(m_arena, node);
         return node;
     }
 
     Statement createFuncDeclStatement(const Identifier* name, FunctionBody body, FormalParameterList parameters, int openBracePos, int closeBracePos, int bodyStartLine, int bodyEndLine)
     {
-        Node* node = new (m_globalData) Node(Node::FunctionDeclStatementType, *name);
-        node->append(parameters);
-        node->append(body);
+        closeFunctionScope(body, parameters, 0);
+        m_scope->declareFunction(name);
+        Node* node = new (m_arena) Node(Node::FunctionDeclStatementType, *name);
+        node->append(m_arena, parameters);
+        node->append(m_arena, body);
         return node;
     }
 
+    // Called on the builder that parsed the body.
     FunctionBody createFunctionBody(SourceElements elements = 0)
     {
-        return new (m_globalData) Node(Node::FunctionBodyType, elements);
+        Node* node = new (m_arena) Node(m_arena, Node::FunctionBodyType, elements);
+        node->setScope(m_scope);
+        return node;
+    }
+
+    FunctionBody createUnparsedFunctionBody()
+    {
+        Node* node = new (m_arena) Node(Node::FunctionBodyType);
+        node->setUnparsed(true);
+        node->setScope(new (m_arena) Scope(m_arena));
+        return node;
     }
 
     Expression createFunctionExpr(const Identifier* name, FunctionBody body, FormalParameterList parameters, int openBracePos, int closeBracePos, int bodyStartLine, int bodyEndLine)
     {
-        Node *node = new (m_globalData) Node(Node::FunctionExpressionType, *name);
-        node->append(parameters);
-        node->append(body);
+        closeFunctionScope(body, parameters, name->length() ? name : 0);
+        Node *node = new (m_arena) Node(Node::FunctionExpressionType, *name);
+        node->append(m_arena, parameters);
+        node->append(m_arena, body);
         return node;
     }
 
@@ -740,180 +943,183 @@ public:
 
     Statement createIfStatement(Expression condition, Statement trueBlock, int start, int end)
     {
-        Node *node = new (m_globalData) Node(Node::IfStatementType, condition);
-        node->append(trueBlock);
+        Node *node = new (m_arena) Node(m_arena, Node::IfStatementType, condition);
+        node->append(m_arena, trueBlock);
         return node;
     }
 
     Statement createIfStatement(Expression condition, Statement trueBlock, Statement falseBlock, int start, int end)
     {
-        Node *node = new (m_globalData) Node(Node::IfStatementType, condition);
-        node->append(trueBlock);
-        node->append(falseBlock);
+        Node *node = new (m_arena) Node(m_arena, Node::IfStatementType, condition);
+        node->append(m_arena, trueBlock);
+        node->append(m_arena, falseBlock);
         return node;
     }
 
     Statement createLabelStatement(const Identifier* ident, Statement statement, int start, int end)
     {
-        Node* node = new (m_globalData) Node(Node::LabelStatementType, *ident);
-        node->append(statement);
+        Node* node = new (m_arena) Node(Node::LabelStatementType, *ident);
+        node->append(m_arena, statement);
         return node;
     }
 
     Expression createLogicalNot(Expression expr)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::LogicalNotOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::LogicalNotOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression createObjectLiteral()
     {
-        return new (m_globalData) Node(Node::ObjectLiteralType);
+        return new (m_arena) Node(Node::ObjectLiteralType);
     }
 
     Expression createObjectLiteral(PropertyList properties)
     {
-        Node* node = new (m_globalData) Node(Node::ObjectLiteralType);
-        node->append(properties);
+        Node* node = new (m_arena) Node(Node::ObjectLiteralType);
+        node->append(m_arena, properties);
         return node;
     }
 
     Expression createNewExpr(Expression expr, Arguments arguments, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::NewExpressionType, expr);
-        node->append(arguments);
+        Node* node = new (m_arena) Node(m_arena, Node::NewExpressionType, expr);
+        node->append(m_arena, arguments);
         return node;
     }
 
     Expression createNewExpr(Expression expr, int start, int end)
     {
-        return new (m_globalData) Node(Node::ExpressionType, expr);
+        return new (m_arena) Node(m_arena, Node::ExpressionType, expr);
     }
 
     Expression createNull()
     {
-        return new (m_globalData) Node(Node::NullType);
+        return new (m_arena) Node(Node::NullType);
     }
 
     Expression createNumberExpr(double d)
     {
-        return new (m_globalData) Node(d);
+        return new (m_arena) Node(d);
     }
 
     template <bool complete>
     Property createProperty(const Identifier* name, Expression expr, PropertyNode::Type type)
     {
-        Node* node = new (m_globalData) Node(Node::PropertyType, *name);
+        Node* node = new (m_arena) Node(Node::PropertyType, *name);
         node->setPropertyType(type);
-        node->append(expr);
+        node->append(m_arena, expr);
         return node;
     }
 
     template <bool complete>
     Property createProperty(JSGlobalData* globalData, double name, Expression expr, PropertyNode::Type type)
     {
-        Identifier id(m_globalData->parser->arena().identifierArena().makeNumericIdentifier(m_globalData, name));
-        Node* node = new (m_globalData) Node(Node::PropertyType, id);
+        const Identifier& id = m_arena.identifierArena().makeNumericIdentifier(m_globalData, name);
+        Node* node = new (m_arena) Node(Node::PropertyType, id);
         node->setPropertyType(type);
-        node->append(expr);
+        node->append(m_arena, expr);
         return node;
     }
 
     PropertyList createPropertyList(Property property)
     {
-        return new (m_globalData) Node(Node::PropertyListType, property);
+        return new (m_arena) Node(m_arena, Node::PropertyListType, property);
     }
 
     PropertyList createPropertyList(Property property, PropertyList tail)
     {
-        tail->append(property);
+        tail->append(m_arena, property);
         return tail;
     }
 
     Expression createRegex(const Identifier& pattern, const Identifier& flags, int start)
     {
-        return new (m_globalData) Node(Node::RegexType, pattern, flags);
+        return new (m_arena) Node(Node::RegexType, pattern, flags);
     }
 
     Expression createResolve(const Identifier* ident, int start)
     {
-        // TODO: check for global arguments
-        return new (m_globalData) Node(Node::ResolveType, *ident);
+        m_scope->use(ident);
+        return new (m_arena) Node(Node::ResolveType, *ident);
     }
 
     Statement createReturnStatement(Expression expression, int eStart, int eEnd, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::ReturnStatementType, expression);
+        return new (m_arena) Node(m_arena, Node::ReturnStatementType, expression);
     }
 
     SourceElements createSourceElements()
     {
-        return new (m_globalData) Node(Node::SourceElementsType);
+        return new (m_arena) Node(Node::SourceElementsType);
     }
 
     Expression createString(const Identifier* string)
     {
-        return new (m_globalData) Node(string->ustring());
+        return new (m_arena) Node(*string);
     }
 
     Statement createSwitchStatement(Expression expr, ClauseList firstClauses, Clause defaultClause, ClauseList secondClauses, int startLine, int endLine)
     {
-        Node* node = new (m_globalData) Node(Node::SwitchStatementType, expr);
-        node->append(firstClauses);
-        node->append(defaultClause);
-        node->append(secondClauses);
+        Node* node = new (m_arena) Node(m_arena, Node::SwitchStatementType, expr);
+        node->append(m_arena, firstClauses);
+        node->append(m_arena, defaultClause);
+        node->append(m_arena, secondClauses);
         return node;
     }
 
     Statement createThrowStatement(Expression expr, int start, int end, int startLine, int endLine)
     {
-        return new (m_globalData) Node(Node::ThrowStatementType, expr);
+        return new (m_arena) Node(m_arena, Node::ThrowStatementType, expr);
     }
 
     Statement createTryStatement(Statement tryBlock, const Identifier* ident, bool catchHasEval, Statement catchBlock, Statement finallyBlock, int startLine, int endLine)
     {
-        Node* node = new (m_globalData) Node(Node::TryStatementType, *ident);
-        node->append(tryBlock);
-        node->append(catchBlock);
-        node->append(finallyBlock);
+        if (catchBlock)
+            m_scope->declareCatchParameter(ident);
+        Node* node = new (m_arena) Node(Node::TryStatementType, *ident);
+        node->append(m_arena, tryBlock);
+        node->append(m_arena, catchBlock);
+        node->append(m_arena, finallyBlock);
         return node;
     }
 
     Expression createUnaryPlus(Expression expr)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::AddOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::AddOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
     Statement createVarStatement(Expression expr, int start, int end)
     {
-        return new (m_globalData) Node(Node::VariableDeclarationType, expr);
+        return new (m_arena) Node(m_arena, Node::VariableDeclarationType, expr);
     }
 
     Statement createWhileStatement(Expression expr, Statement statement, int startLine, int endLine)
     {
-        Node* node = new (m_globalData) Node(Node::WhileStatementType, expr);
-        node->append(statement);
+        Node* node = new (m_arena) Node(m_arena, Node::WhileStatementType, expr);
+        node->append(m_arena, statement);
         return node;
     }
 
     Statement createWithStatement(Expression expr, Statement statement, int start, int end, int startLine, int endLine)
     {
-        Node* node = new (m_globalData) Node(Node::WithStatementType, expr);
-        node->append(statement);
+        m_scope->setUsesWith();
+        Node* node = new (m_arena) Node(m_arena, Node::WithStatementType, expr);
+        node->append(m_arena, statement);
         return node;
     }
 
     Expression createVarIdentifier(const Identifier* ident)
     {
-        return new (m_globalData) Node(Node::IdentifierExpressionType, *ident);
+        return new (m_arena) Node(Node::IdentifierExpressionType, *ident);
     }
 
     Expression createVoid(Expression expr)
     {
-        return new (m_globalData) Node(Node::VoidType);
+        return new (m_arena) Node(Node::VoidType);
     }
 
     // JSParser uses this to find out if there is eval inside a try statement.
@@ -940,59 +1146,62 @@ public:
 
     Expression makeBinaryNode(int token, pair<Expression, BinaryOpInfo> lhs, pair<Expression, BinaryOpInfo> rhs)
     {
-        Node* node = new (m_globalData) Node(Node::BinaryExpressionType, Node::convertOperator(token));
-        node->append(lhs.first);
-        node->append(rhs.first);
+        Node* node = new (m_arena) Node(Node::BinaryExpressionType, Node::convertOperator(token));
+        node->setRange(lhs.second.start, rhs.second.end);
+        node->append(m_arena, lhs.first);
+        node->append(m_arena, rhs.first);
         return node;
     }
 
     Expression makeBitwiseNotNode(Expression expr)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::BitwiseNotOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::BitwiseNotOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression makeDeleteNode(Expression expr, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::DeleteOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::DeleteOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression makeFunctionCallNode(Expression func, Arguments args, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::FunctionCallType);
-        node->append(func);
-        node->append(args);
+        if (func->type() == Node::ResolveType && isEval(func->identifier()))
+            m_scope->setUsesEval();
+        Node* node = new (m_arena) Node(Node::FunctionCallType);
+        node->append(m_arena, func);
+        node->append(m_arena, args);
         return node;
     }
 
     Expression makeNegateNode(Expression expr)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::SubtractOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::SubtractOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression makePostfixNode(Expression expr, Operator op, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::PostfixType, Node::convertOperator(op));
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::PostfixType, Node::convertOperator(op));
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression makePrefixNode(Expression expr, Operator op, int start, int divot, int end)
     {
-        Node* node = new (m_globalData) Node(Node::PrefixType, Node::convertOperator(op));
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::PrefixType, Node::convertOperator(op));
+        node->append(m_arena, expr);
         return node;
     }
 
     Expression makeTypeOfNode(Expression expr)
     {
-        Node* node = new (m_globalData) Node(Node::UnaryExpressionType, Node::TypeofOperator);
-        node->append(expr);
+        Node* node = new (m_arena) Node(Node::UnaryExpressionType, Node::TypeofOperator);
+        node->append(m_arena, expr);
         return node;
     }
 
@@ -1004,7 +1213,7 @@ public:
     void operatorStackAppend(int& operatorStackDepth, int op, int precedence)
     {
         operatorStackDepth++;
-        m_binaryOperatorStack.append(std::make_pair(op, precedence));
+        m_binaryOperatorStack.append(m_arena, std::make_pair(op, precedence));
     }
 
     void operatorStackPop(int& operatorStackDepth)
@@ -1020,20 +1229,31 @@ public:
         return result;
     }
 
+    void setRange(Node* node, int start, int end)
+    {
+        node->setRange(start, end);
+    }
+
     void setUsesArguments(FunctionBody function)
     {
     }
 
+    void closeProgramScope(SourceElements elements)
+    {
+        m_scope->close(0, 0);
+        elements->setScope(m_scope);
+    }
+
     void shrinkOperandStackBy(int& operandStackDepth, int amount)
     {
         operandStackDepth -= amount;
         ASSERT(operandStackDepth >= 0);
-        m_binaryOperandStack.resize(m_binaryOperandStack.size() - amount);
+        m_binaryOperandStack.shrink(m_binaryOperandStack.size() - amount);
     }
 
     Expression thisExpr()
     {
-        return new (m_globalData) Node(Node::ThisType);
+        return new (m_arena) Node(Node::ThisType);
     }
 
     int unaryTokenStackLastStart(int&)
@@ -1053,11 +1273,115 @@ public:
     }
 
 private:
+    static bool isEval(const Identifier& name)
+    {
+        const UChar* characters = name.characters();
+        return name.length() == 4 && characters[0] == 'e' && characters[1] == 'v' && characters[2] == 'a' && characters[3] == 'l';
+    }
+
+    // The parameters form a chain, each the child of the one before it.
+    void closeFunctionScope(FunctionBody body, FormalParameterList parameters, const Identifier* name)
+    {
+        Scope* scope = body->scope();
+        for (Node* parameter = parameters; parameter; parameter = parameter->childCount() ? parameter->childAt(0) : 0)
+            scope->addParameter(&parameter->identifier());
+        scope->close(name, m_argumentsIdentifier);
+        m_scope->addNested(*scope);
+    }
+
     JSGlobalData* m_globalData;
-    Vector<AssignmentInfo, 10> m_assignmentInfoStack;
-    Vector<BinaryOperand, 10> m_binaryOperandStack;
-    Vector<pair<int, int>, 10> m_binaryOperatorStack;
-    Vector<pair<int, int>, 10> m_unaryTokenStack;
+    ParserArena& m_arena;
+    const Identifier* m_argumentsIdentifier;
+    Scope* m_scope;
+    // Kept in the arena, so that the builder of every function body starts
+    // its stacks without touching the heap.
+    ArenaVector<AssignmentInfo> m_assignmentInfoStack;
+    ArenaVector<BinaryOperand> m_binaryOperandStack;
+    ArenaVector<pair<int, int> > m_binaryOperatorStack;
+    ArenaVector<pair<int, int> > m_unaryTokenStack;
+};
+
+// The result of Parser::parse(): the root of the tree together with the arena
+// that owns its nodes and identifiers. Nodes stay valid as long as the Program
+// is alive.
+class Program : public Noncopyable {
+public:
+    Program()
+        : m_root(0)
+    {
+    }
+
+    ~Program()
+    {
+        for (size_t i = 0; i < m_workerArenas.size(); ++i)
+            delete m_workerArenas[i];
+    }
+
+    Node* root() const { return m_root; }
+    void setRoot(Node* root) { m_root = root; }
+
+    // Lets go of the tree, the source and the diagnostics, keeping the memory
+    // of the arena and the other tables for the next parse into the program.
+    void reset()
+    {
+        m_root = 0;
+        m_arena.reset();
+        for (size_t i = 0; i < m_workerArenas.size(); ++i)
+            delete m_workerArenas[i];
+        m_workerArenas.shrink(0);
+        m_source = SourceCode();
+        m_retainedSources.shrink(0);
+        m_braceMatches.reset();
+        m_trivia.reset();
+        m_diagnostics.shrink(0);
+    }
+
+    ParserArena& arena() { return m_arena; }
+
+    // Further arenas, one for each thread that parsed function bodies of the
+    // program in parallel. Their identifiers are not shared with the others.
+    ParserArena& createWorkerArena()
+    {
+        m_workerArenas.append(new ParserArena);
+        return *m_workerArenas.last();
+    }
+    const Vector<ParserArena*>& workerArenas() const { return m_workerArenas; }
+
+    const SourceLines& sourceLines() const { return m_sourceLines; }
+    SourceLines& sourceLines() { return m_sourceLines; }
+
+    // The parsed source, kept to parse skipped function bodies on demand.
+    const SourceCode& source() const { return m_source; }
+    void setSource(const SourceCode& source) { m_source = source; }
+
+    // Keeps a source other than the current one alive with the program, as
+    // identifiers in its arena may refer to the characters of the source.
+    void retainSource(const SourceCode& source) { m_retainedSources.append(source); }
+    unsigned retainedSourceCount() const { return m_retainedSources.size(); }
+
+    const BraceMatches& braceMatches() const { return m_braceMatches; }
+    BraceMatches& braceMatches() { return m_braceMatches; }
+
+    // Comments and the trivia before tokens, recorded by a parse with
+    // Parser::RecordTrivia.
+    const TriviaTable& trivia() const { return m_trivia; }
+    TriviaTable& trivia() { return m_trivia; }
+
+    // Syntax errors found by a parse with Parser::RecoverFromErrors, in the
+    // order of the source.
+    const Vector<ParseDiagnostic>& diagnostics() const { return m_diagnostics; }
+    Vector<ParseDiagnostic>& diagnostics() { return m_diagnostics; }
+
+private:
+    ParserArena m_arena;
+    SourceLines m_sourceLines;
+    SourceCode m_source;
+    Vector<SourceCode> m_retainedSources;
+    BraceMatches m_braceMatches;
+    TriviaTable m_trivia;
+    Vector<ParseDiagnostic> m_diagnostics;
+    Vector<ParserArena*> m_workerArenas;
+    Node* m_root;
 };
 
 } // namespace SyntaxTree
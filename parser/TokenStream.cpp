@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "TokenStream.h"
+
+namespace JSC {
+
+typedef TokenStream::Token Token;
+
+template <typename T>
+static inline const T* sourceCharacters(const SourceProvider*);
+
+template <>
+inline const LChar* sourceCharacters<LChar>(const SourceProvider* provider)
+{
+    return provider->data8();
+}
+
+template <>
+inline const UChar* sourceCharacters<UChar>(const SourceProvider* provider)
+{
+    return provider->data();
+}
+
+// Counts line terminators the way Lexer::shiftLineTerminator() does, so CRLF
+// and LFCR are one line terminator each.
+template <typename T>
+static int countLineTerminators(const SourceProvider* provider, int start, int end)
+{
+    const T* characters = sourceCharacters<T>(provider);
+    int count = 0;
+    for (int i = start; i < end; ++i) {
+        if (!Lexer<T>::isLineTerminator(characters[i]))
+            continue;
+        if (i + 1 < end && characters[i] + characters[i + 1] == '\n' + '\r')
+            ++i;
+        ++count;
+    }
+    return count;
+}
+
+static int countLineTerminators(const SourceProvider* provider, int start, int end)
+{
+    if (provider->is8Bit())
+        return countLineTerminators<LChar>(provider, start, end);
+    return countLineTerminators<UChar>(provider, start, end);
+}
+
+static bool isLineTerminatorAt(const SourceProvider* provider, int offset)
+{
+    int character = provider->is8Bit() ? provider->data8()[offset] : provider->data()[offset];
+    return Lexer<UChar>::isLineTerminator(character);
+}
+
+static inline bool isRegExp(const Token& token)
+{
+    return (token.type == DIVIDE && token.end - token.start > 1) || (token.type == DIVEQUAL && token.end - token.start > 2);
+}
+
+// Whether a slash after the token, or at the start for 0, starts a regular
+// expression.
+static bool regExpAllowedAfter(const Token* token)
+{
+    if (!token)
+        return true;
+
+    switch (token->type) {
+    case IDENT:
+    case NUMBER:
+    case STRING:
+    case NULLTOKEN:
+    case TRUETOKEN:
+    case FALSETOKEN:
+    case THISTOKEN:
+    case CLOSEPAREN:
+    case CLOSEBRACKET:
+    case PLUSPLUS:
+    case MINUSMINUS:
+        return false;
+    case DIVIDE:
+    case DIVEQUAL:
+        return !isRegExp(*token);
+    default:
+        return true;
+    }
+}
+
+// A lexer over a source with an arena of its own, for the identifiers it
+// makes and drops.
+template <typename T>
+class TokenReader : public Noncopyable {
+public:
+    TokenReader(JSGlobalData* globalData, const SourceCode& source)
+        : m_lexer(globalData)
+    {
+        m_lexer.setCode(source, m_arena);
+    }
+
+    ~TokenReader()
+    {
+        m_lexer.clear();
+    }
+
+    LexerState state() const { return m_lexer.state(); }
+    void restoreState(const LexerState& state) { m_lexer.restoreState(state); }
+
+    // Reads the token after previous, which is 0 at the start.
+    Token read(const Token* previous)
+    {
+        Token token;
+        token.before = m_lexer.state();
+
+        JSTokenData data;
+        JSTokenInfo info;
+        token.type = m_lexer.lex(&data, &info, Lexer<T>::IdentifyReservedWords);
+        if (token.type == EOFTOK) {
+            token.start = m_lexer.currentOffset();
+            token.end = token.start;
+            token.line = m_lexer.lineNumber();
+            return token;
+        }
+        if (token.type == ERRORTOK) {
+            // The lexer does not say where the token started.
+            token.start = token.before.offset;
+            return recover(token);
+        }
+
+        token.start = info.startOffset;
+        token.end = info.endOffset;
+        token.line = info.line;
+        if ((token.type == DIVIDE || token.type == DIVEQUAL) && regExpAllowedAfter(previous)) {
+            const Identifier* pattern;
+            const Identifier* flags;
+            if (!m_lexer.scanRegExp(pattern, flags, token.type == DIVEQUAL ? '=' : 0)) {
+                token.type = ERRORTOK;
+                return recover(token);
+            }
+            token.end = m_lexer.currentOffset();
+        }
+        return token;
+    }
+
+private:
+    Token recover(Token& token)
+    {
+        m_lexer.recoverFromError();
+        token.end = m_lexer.currentOffset();
+        token.line = m_lexer.lineNumber();
+        return token;
+    }
+
+    ParserArena m_arena;
+    Lexer<T> m_lexer;
+};
+
+template <typename T>
+static void lexTokens(JSGlobalData* globalData, const SourceCode& source, Vector<Token>& tokens)
+{
+    TokenReader<T> reader(globalData, source);
+    do
+        tokens.append(reader.read(tokens.isEmpty() ? 0 : &tokens.last()));
+    while (tokens.last().type != EOFTOK);
+}
+
+void TokenStream::lex(JSGlobalData* globalData, const SourceCode& source)
+{
+    m_source = source;
+    m_tokens.shrink(0);
+    if (source.provider()->is8Bit())
+        lexTokens<LChar>(globalData, source, m_tokens);
+    else
+        lexTokens<UChar>(globalData, source, m_tokens);
+}
+
+// Reads tokens of the edited source from the state of tokens[first] until
+// the state is that of an old token past the edit, and puts them in place of
+// the old tokens before that one.
+template <typename T>
+static size_t relexTokens(JSGlobalData* globalData, const SourceCode& source, const SourceEdit& edit, int lineDelta, size_t first, Vector<Token>& tokens)
+{
+    int delta = edit.insertedText.length() - edit.removedLength;
+    int editEnd = edit.offset + edit.removedLength;
+
+    TokenReader<T> reader(globalData, source);
+    reader.restoreState(tokens[first].before);
+
+    Vector<Token> relexed;
+    const Token* previous = first ? &tokens[first - 1] : 0;
+    size_t old = first;
+    bool resynchronized = false;
+    while (true) {
+        LexerState state = reader.state();
+        if (state.offset - delta >= editEnd) {
+            while (old < tokens.size() && tokens[old].before.offset + delta < state.offset)
+                ++old;
+            // The token before decides what a slash is, so it must agree as well.
+            if (old < tokens.size() && state.isResynchronizedWith(tokens[old].before, delta, lineDelta)
+                && regExpAllowedAfter(previous) == regExpAllowedAfter(old ? &tokens[old - 1] : 0)) {
+                resynchronized = true;
+                break;
+            }
+        }
+
+        relexed.append(reader.read(previous));
+        previous = &relexed.last();
+        if (previous->type == EOFTOK)
+            break;
+    }
+
+    if (!resynchronized)
+        old = tokens.size();
+    tokens.remove(first, old - first);
+    tokens.insert(first, relexed.data(), relexed.size());
+    for (size_t i = first + relexed.size(); i < tokens.size(); ++i) {
+        Token& token = tokens[i];
+        token.start += delta;
+        token.end += delta;
+        token.line += lineDelta;
+        token.before.offset += delta;
+        token.before.lineNumber += lineDelta;
+    }
+    return relexed.size();
+}
+
+size_t TokenStream::relex(JSGlobalData* globalData, const SourceCode& source, const SourceEdit& edit)
+{
+    ASSERT(edit.offset >= m_source.startOffset() && edit.removedLength >= 0 && edit.offset + edit.removedLength <= m_source.endOffset());
+    ASSERT(source.length() == m_source.length() + edit.insertedText.length() - edit.removedLength);
+
+    if (m_tokens.isEmpty()) {
+        lex(globalData, source);
+        return m_tokens.size();
+    }
+
+    // Tokens end in order. The first one that reaches the edit may change,
+    // and so may the one before it, whose end the lexer found by looking at
+    // the next character.
+    size_t low = 0;
+    size_t high = m_tokens.size() - 1;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (m_tokens[middle].end < edit.offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    size_t first = low ? low - 1 : 0;
+
+    // Lines are counted from where relexing starts to past the edit and any
+    // line terminators after it, which may pair up with those of the edit.
+    int delta = edit.insertedText.length() - edit.removedLength;
+    int resume = m_tokens[first].before.offset;
+    int end = edit.offset + edit.removedLength;
+    while (end < m_source.endOffset() && isLineTerminatorAt(m_source.provider(), end))
+        ++end;
+    int lineDelta = countLineTerminators(source.provider(), resume, end + delta) - countLineTerminators(m_source.provider(), resume, end);
+
+    m_source = source;
+    if (source.provider()->is8Bit())
+        return relexTokens<LChar>(globalData, source, edit, lineDelta, first, m_tokens);
+    return relexTokens<UChar>(globalData, source, edit, lineDelta, first, m_tokens);
+}
+
+} // namespace JSC
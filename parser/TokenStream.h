@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TokenStream_h
+#define TokenStream_h
+
+#include <Parser.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// The tokens of a source, for editors that color or navigate the text
+// without parsing it, kept up to date as the source is edited.
+//
+// Each token holds the lexer state it was read from. After an edit, relex()
+// resumes from the state of the token before the first one the edit touched
+// and reads tokens until the lexer state is that of an old token past the
+// edit, moved by the edit's offset and line deltas; the tokens from there on
+// are the old ones, moved. A keystroke costs the few tokens around it.
+//
+// The lexer alone cannot tell a slash that starts a regular expression from
+// a division, so the token before decides: a slash after an operand, a
+// closing parenthesis or bracket included, is a division. A regular
+// expression right after the condition of an if, for, while or with is
+// therefore read as divisions, which the parser would not do.
+class TokenStream : public Noncopyable
+{
+public:
+    struct Token {
+        // A regular expression literal is a DIVIDE or DIVEQUAL token that
+        // covers the whole literal, as the parser extends it. A syntax error
+        // is an ERRORTOK up to the end of its line, where lexing resumes.
+        JSTokenType type;
+        int start;
+        int end;
+        int line;
+        // The state the lexer reads the token from.
+        LexerState before;
+    };
+
+    // Lexes the whole source. The last token is an EOFTOK.
+    void lex(JSGlobalData*, const SourceCode&);
+
+    // Brings the tokens up to date with source, which is the source lexed
+    // before with the edit applied. Offsets are those of the providers.
+    // Returns the number of tokens read again.
+    size_t relex(JSGlobalData*, const SourceCode&, const SourceEdit&);
+
+    const SourceCode& source() const { return m_source; }
+    const Vector<Token>& tokens() const { return m_tokens; }
+
+private:
+    SourceCode m_source;
+    Vector<Token> m_tokens;
+};
+
+} // namespace JSC
+
+#endif // TokenStream_h
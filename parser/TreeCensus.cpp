@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "TreeCensus.h"
+
+#include "TreeDumper.h"
+
+#include <string.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+static const char* const typeNames[SyntaxTree::Node::TypeCount] = {
+    "ArgumentsList",
+    "Arguments",
+    "Array",
+    "AssignmentExpression",
+    "Assign",
+    "BinaryExpression",
+    "BlockStatement",
+    "BooleanExpression",
+    "BracketAccess",
+    "BreakStatement",
+    "Comma",
+    "ConditionalExpression",
+    "ConstDeclaration",
+    "ConstStatement",
+    "ContinueStatement",
+    "Clause",
+    "ClauseList",
+    "Debugger",
+    "Declaration",
+    "DoWhileStatement",
+    "DotAccess",
+    "ElementList",
+    "EmptyStatement",
+    "ExpressionStatement",
+    "Expression",
+    "ForInLoop",
+    "ForLoop",
+    "FormalParameterList",
+    "FunctionBody",
+    "FunctionCall",
+    "FunctionDeclStatement",
+    "FunctionExpression",
+    "IdentifierExpression",
+    "IfStatement",
+    "LabelStatement",
+    "NewExpression",
+    "Null",
+    "NumberExpression",
+    "ObjectLiteral",
+    "Postfix",
+    "Prefix",
+    "Property",
+    "PropertyList",
+    "Regex",
+    "Resolve",
+    "ReturnStatement",
+    "SourceElements",
+    "Statement",
+    "StringExpression",
+    "SwitchStatement",
+    "This",
+    "ThrowStatement",
+    "TryStatement",
+    "UnaryExpression",
+    "VariableDeclaration",
+    "Void",
+    "WhileStatement",
+    "WithStatement"
+};
+
+const char* TreeCensus::typeName(int type)
+{
+    ASSERT(type >= 0 && type < SyntaxTree::Node::TypeCount);
+    return typeNames[type];
+}
+
+TreeCensus::TreeCensus()
+    : m_nodeCount(0)
+    , m_childVectorBytes(0)
+    , m_stringBytes(0)
+    , m_arenaPoolCount(0)
+    , m_arenaBytes(0)
+    , m_arenaUnusedBytes(0)
+    , m_identifierCount(0)
+    , m_identifierLookupCount(0)
+    , m_identifierBytes(0)
+{
+    memset(m_counts, 0, sizeof(m_counts));
+}
+
+void TreeCensus::take(SyntaxTree::Program* program)
+{
+    if (program->root())
+        program->root()->apply(this);
+
+    takeArena(program->arena());
+    for (size_t i = 0; i < program->workerArenas().size(); ++i)
+        takeArena(*program->workerArenas()[i]);
+}
+
+void TreeCensus::takeArena(ParserArena& arena)
+{
+    m_arenaPoolCount += arena.poolCount();
+    m_arenaBytes += arena.allocatedBytes();
+    m_arenaUnusedBytes += arena.unusedBytes();
+
+    takeIdentifierArena(arena.identifierArena());
+}
+
+void TreeCensus::process(SyntaxTree::Node* n)
+{
+    m_counts[n->type()]++;
+    m_nodeCount++;
+    m_childVectorBytes += n->childCapacity() * sizeof(SyntaxTree::Node*);
+    // Identifiers are shared through the IdentifierArena and accounted for
+    // there, and node strings share the characters of identifiers. A string
+    // that owns its characters is heap memory no one frees.
+    if (n->string().ownsCharacters())
+        m_stringBytes += n->string().length() * sizeof(UChar);
+
+    for (int i = 0; i < n->childCount(); ++i) {
+        if (SyntaxTree::Node* child = n->childAt(i))
+            child->apply(this);
+    }
+}
+
+void TreeCensus::takeIdentifierArena(IdentifierArena& identifiers)
+{
+    // Identifiers spelled out in a UTF-16 source share its characters, the
+    // others share a copy in the arena. Either way the arena holds each
+    // name once.
+    m_identifierCount += identifiers.size();
+    m_identifierBytes += identifiers.tableBytes() + identifiers.size() * sizeof(Identifier);
+    m_identifierLookupCount += identifiers.lookupCount();
+}
+
+double TreeCensus::lookupsPerIdentifier() const
+{
+    if (!m_identifierCount)
+        return 0;
+    return static_cast<double>(m_identifierLookupCount) / m_identifierCount;
+}
+
+UString TreeCensus::toJSON() const
+{
+    Vector<char> json;
+    appendFormat(json, "{\n");
+    appendFormat(json, "    \"nodes\": %u,\n", m_nodeCount);
+    appendFormat(json, "    \"nodeBytes\": %lu,\n", static_cast<unsigned long>(nodeBytes()));
+    appendFormat(json, "    \"childVectorBytes\": %lu,\n", static_cast<unsigned long>(m_childVectorBytes));
+    appendFormat(json, "    \"stringBytes\": %lu,\n", static_cast<unsigned long>(m_stringBytes));
+    appendFormat(json, "    \"arenaPools\": %lu,\n", static_cast<unsigned long>(m_arenaPoolCount));
+    appendFormat(json, "    \"arenaBytes\": %lu,\n", static_cast<unsigned long>(m_arenaBytes));
+    appendFormat(json, "    \"arenaUnusedBytes\": %lu,\n", static_cast<unsigned long>(m_arenaUnusedBytes));
+    appendFormat(json, "    \"identifiers\": %lu,\n", static_cast<unsigned long>(m_identifierCount));
+    appendFormat(json, "    \"identifierLookups\": %lu,\n", static_cast<unsigned long>(m_identifierLookupCount));
+    appendFormat(json, "    \"identifierBytes\": %lu,\n", static_cast<unsigned long>(m_identifierBytes));
+    appendFormat(json, "    \"lookupsPerIdentifier\": %.3f,\n", lookupsPerIdentifier());
+    appendFormat(json, "    \"types\": {");
+    bool first = true;
+    for (int type = 0; type < SyntaxTree::Node::TypeCount; ++type) {
+        if (!m_counts[type])
+            continue;
+        appendFormat(json, "%s\n        \"%s\": %u", first ? "" : ",", typeNames[type], m_counts[type]);
+        first = false;
+    }
+    appendFormat(json, "\n    }\n}\n");
+    return UString(json.data(), json.size());
+}
+
+} // namespace JSC
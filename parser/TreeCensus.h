@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TreeCensus_h
+#define TreeCensus_h
+
+#include <SyntaxTree.h>
+
+namespace JSC {
+
+// Walks a parsed program and accounts for the memory it uses: how many
+// nodes of each type there are, how much of the arena they and their child
+// vectors occupy, what string payloads cost on the heap, and how often the
+// identifier arena hands out each name it stores.
+class TreeCensus : public SyntaxTree::Visitor
+{
+public:
+    TreeCensus();
+
+    void take(SyntaxTree::Program*);
+
+    virtual void process(SyntaxTree::Node*);
+
+    unsigned count(int type) const { return m_counts[type]; }
+    unsigned nodeCount() const { return m_nodeCount; }
+    size_t nodeBytes() const { return m_nodeCount * sizeof(SyntaxTree::Node); }
+    size_t childVectorBytes() const { return m_childVectorBytes; }
+    size_t stringBytes() const { return m_stringBytes; }
+
+    size_t arenaPoolCount() const { return m_arenaPoolCount; }
+    size_t arenaBytes() const { return m_arenaBytes; }
+    size_t arenaUnusedBytes() const { return m_arenaUnusedBytes; }
+
+    size_t identifierCount() const { return m_identifierCount; }
+    size_t identifierLookupCount() const { return m_identifierLookupCount; }
+    size_t identifierBytes() const { return m_identifierBytes; }
+    // How many times each stored name was looked up on average, that is how
+    // many copies interning saved.
+    double lookupsPerIdentifier() const;
+
+    UString toJSON() const;
+
+    static const char* typeName(int type);
+
+private:
+    void takeArena(ParserArena&);
+    void takeIdentifierArena(IdentifierArena&);
+
+    unsigned m_counts[SyntaxTree::Node::TypeCount];
+    unsigned m_nodeCount;
+    size_t m_childVectorBytes;
+    size_t m_stringBytes;
+    size_t m_arenaPoolCount;
+    size_t m_arenaBytes;
+    size_t m_arenaUnusedBytes;
+    size_t m_identifierCount;
+    size_t m_identifierLookupCount;
+    size_t m_identifierBytes;
+};
+
+} // namespace JSC
+
+#endif // TreeCensus_h
@@ -29,6 +29,8 @@
 
 #include <Nodes.h>
 #include <SyntaxTree.h>
+#include <stdarg.h>
+#include <stdio.h>
 
 namespace JSC {
 
@@ -88,31 +90,56 @@ JSONTreeDumper::JSONTreeDumper()
 
 void JSONTreeDumper::start()
 {
-    tmpnam(fileName);
-    buffer = fopen(fileName, "wt");
+    buffer.clear();
 }
 
 void JSONTreeDumper::finish()
 {
-    fclose(buffer);
-
-    buffer  = fopen(fileName, "rt");
-    fseek(buffer, 0, SEEK_END);
-    int len = ftell(buffer);
-    rewind(buffer);
-    char* data = new char[len + 1];
-    fread(data, 1, len, buffer);
-    data[len] = '\0';
-    fclose(buffer);
-
-    tree = UString(data, len);
-    delete [] data;
+    tree = UString(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+static void appendFormatV(Vector<char>& buffer, const char* format, va_list args)
+{
+    char text[256];
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(text, sizeof(text), format, copy);
+    va_end(copy);
+    ASSERT(length >= 0);
+
+    if (static_cast<size_t>(length) < sizeof(text)) {
+        buffer.append(text, length);
+        return;
+    }
+
+    // Too long for the stack; format again straight into the buffer.
+    size_t start = buffer.size();
+    buffer.grow(start + length + 1);
+    vsnprintf(buffer.data() + start, length + 1, format, args);
+    buffer.shrink(start + length);
+}
+
+void appendFormat(Vector<char>& buffer, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    appendFormatV(buffer, format, args);
+    va_end(args);
+}
+
+void JSONTreeDumper::print(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    appendFormatV(buffer, format, args);
+    va_end(args);
 }
 
 void JSONTreeDumper::printSpaces(int indent)
 {
     for (int i = 0; i < indent; ++i)
-        fprintf(buffer, "    ");
+        print("    ");
 }
 
 void JSONTreeDumper::printString(const UString &str)
@@ -120,31 +147,35 @@ void JSONTreeDumper::printString(const UString &str)
     for (unsigned c = 0; c < str.length(); ++c) {
         switch (str[c]) {
         case '"':
-            fprintf(buffer, "\\\"");
+            print("\\\"");
             break;
         case '\\':
-            fprintf(buffer, "\\\\");
+            print("\\\\");
             break;
         case '\b':
-            fprintf(buffer, "\\b");
+            print("\\b");
             break;
         case '\f':
-            fprintf(buffer, "\\f");
+            print("\\f");
             break;
         case '\n':
-            fprintf(buffer, "\\n");
+            print("\\n");
             break;
         case '\r':
-            fprintf(buffer, "\\r");
+            print("\\r");
             break;
         case '\v':
-            fprintf(buffer, "\\\\v");
+            print("\\\\v");
             break;
         case '\t':
-            fprintf(buffer, "\\t");
+            print("\\t");
             break;
         default:
-            fprintf(buffer, "%c", str[c]);
+            // The dump is ASCII; JSON.parse() restores other characters.
+            if (str[c] < 0x20 || str[c] >= 0x7F)
+                print("\\u%04x", str[c]);
+            else
+                print("%c", str[c]);
         }
     }
 }
@@ -154,38 +185,38 @@ void JSONTreeDumper::visitChild(SyntaxTree::Node* n, int index, const char* name
     printSpaces(indent);
     SyntaxTree::Node* node = (index < n->childCount()) ? n->childAt(index) : 0;
     if (!node) {
-        fprintf(buffer, "\"%s\": null", name);
+        print("\"%s\": null", name);
     } else {
         if (name)
-            fprintf(buffer, "\"%s\": {\n", name);
+            print("\"%s\": {\n", name);
         ++indent;
         node->apply(this);
         --indent;
         if (name) {
             printSpaces(indent);
-            fprintf(buffer, "}");
+            print("}");
         }
     }
 }
 
 void JSONTreeDumper::visitAllChildren(SyntaxTree::Node* n, bool showIndex)
 {
-    fprintf(buffer, "[");
+    print("[");
     for (int index = 0; index < n->childCount(); ++index) {
         if (index > 0) {
-            fprintf(buffer, "\n");
+            print("\n");
             printSpaces(indent);
         }
-        fprintf(buffer, "{\n");
+        print("{\n");
         ++indent;
         n->childAt(index)->apply(this);
         --indent;
         printSpaces(indent);
-        fprintf(buffer, "}");
+        print("}");
         if (index < n->childCount() - 1)
-            fprintf(buffer, ",");
+            print(",");
     }
-    fprintf(buffer, "]");
+    print("]");
 }
 
 void JSONTreeDumper::process(SyntaxTree::Node* n)
@@ -194,7 +225,7 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
         if (n->childCount() && n->childAt(0))
             n->childAt(0)->apply(this);
         else
-            fprintf(buffer, "[]");
+            print("[]");
         return;
     }
 
@@ -205,90 +236,90 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
 
     if (n->type() == SyntaxTree::Node::ArrayType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ArrayExpression\",\n");
+        print("\"type\": \"ArrayExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"elements\": ");
+        print("\"elements\": ");
         if (n->childCount() && n->childAt(0))
             n->childAt(0)->apply(this);
         else
-            fprintf(buffer, "[]");
-        fprintf(buffer, "\n");
+            print("[]");
+        print("\n");
         return;
     }
 
     // FIXME: should be variable init inside declaration?
     if (n->type() == SyntaxTree::Node::AssignmentExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"AssignmentExpression\",\n");
+        print("\"type\": \"AssignmentExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"%s\",\n", operatorAsText(n->op()));
+        print("\"operator\": \"%s\",\n", operatorAsText(n->op()));
         visitChild(n, 0, "left");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "right");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::BinaryExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"BinaryExpression\",\n");
+        print("\"type\": \"BinaryExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"%s\",\n", operatorAsText(n->op()));
+        print("\"operator\": \"%s\",\n", operatorAsText(n->op()));
         visitChild(n, 0, "left");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "right");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::BlockStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"BlockStatement\",\n");
+        print("\"type\": \"BlockStatement\",\n");
         printSpaces(indent);
         if (n->childCount() == 1)
             if (n->childAt(0))
                 if (n->childAt(0)->type() == SyntaxTree::Node::SourceElementsType) {
-                    fprintf(buffer, "\"body\": ");
+                    print("\"body\": ");
                     visitAllChildren(n->childAt(0));
-                    fprintf(buffer, "\n");
+                    print("\n");
                     return;
                 }
-        fprintf(buffer, "\"body\": []\n");
+        print("\"body\": []\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::BooleanExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Literal\",\n");
+        print("\"type\": \"Literal\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"objtype\": \"Boolean\",\n");
+        print("\"objtype\": \"Boolean\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"value\": %s\n", n->boolean() ? "true" : "false");
+        print("\"value\": %s\n", n->boolean() ? "true" : "false");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::BracketAccessType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"MemberExpression\",\n");
+        print("\"type\": \"MemberExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"accesstype\": \"Bracket\",\n");
+        print("\"accesstype\": \"Bracket\",\n");
         visitChild(n, 0, "object");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "property");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::BreakStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"BreakStatement\",\n");
+        print("\"type\": \"BreakStatement\",\n");
         printSpaces(indent);
         if (n->identifier().ustring().isEmpty()) {
-            fprintf(buffer, "\"label\": null\n");
+            print("\"label\": null\n");
         } else {
-            fprintf(buffer, "\"label\": ");
+            print("\"label\": ");
             printString(n->identifier().ustring());
-            fprintf(buffer, "\n");
+            print("\n");
         }
         return;
     }
@@ -297,91 +328,91 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
         if (n->childCount())
             visitAllChildren(n);
         else
-            fprintf(buffer, "[]");
+            print("[]");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ClauseType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"SwitchCase\",\n");
+        print("\"type\": \"SwitchCase\",\n");
         visitChild(n, 0, "test");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
         if (n->childAt(1)) {
-            fprintf(buffer, "\"consequent\": [{\n");
+            print("\"consequent\": [{\n");
             n->childAt(1)->apply(this);
             printSpaces(indent);
-            fprintf(buffer, "}]");
+            print("}]");
         } else {
-            fprintf(buffer, "\"consequent\": []");
+            print("\"consequent\": []");
         }
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::CommaType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"SequenceExpression\",\n");
+        print("\"type\": \"SequenceExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"expressions\": ");
+        print("\"expressions\": ");
         visitAllChildren(n);
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ContinueStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ContinueStatement\",\n");
+        print("\"type\": \"ContinueStatement\",\n");
         printSpaces(indent);
         if (n->identifier().ustring().isEmpty()) {
-            fprintf(buffer, "\"label\": null\n");
+            print("\"label\": null\n");
         } else {
-            fprintf(buffer, "\"label\": ");
+            print("\"label\": ");
             printString(n->identifier().ustring());
-            fprintf(buffer, "\n");
+            print("\n");
         }
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ConditionalExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ConditionalExpression\",\n");
+        print("\"type\": \"ConditionalExpression\",\n");
         visitChild(n, 0, "test");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "consequent");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 2, "alternate");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::DotAccessType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"MemberExpression\",\n");
+        print("\"type\": \"MemberExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"accesstype\": \"Dot\",\n");
+        print("\"accesstype\": \"Dot\",\n");
         visitChild(n, 0, "object");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"property\": {\n");
+        print("\"property\": {\n");
         printSpaces(indent + 1);
-        fprintf(buffer, "\"type\": \"Identifier\",\n");
+        print("\"type\": \"Identifier\",\n");
         printSpaces(indent + 1);
-        fprintf(buffer, "\"name\": \"");
+        print("\"name\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         printSpaces(indent);
-        fprintf(buffer, "}\n");
+        print("}\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::DoWhileStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"DoWhileStatement\",\n");
+        print("\"type\": \"DoWhileStatement\",\n");
         visitChild(n, 0, "body");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "test");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
@@ -392,128 +423,128 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
 
     if (n->type() == SyntaxTree::Node::EmptyStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"EmptyStatement\"\n");
+        print("\"type\": \"EmptyStatement\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ExpressionStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ExpressionStatement\",\n");
+        print("\"type\": \"ExpressionStatement\",\n");
         visitChild(n, 0, "expression");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ExpressionStatement\",\n");
+        print("\"type\": \"ExpressionStatement\",\n");
         visitChild(n, 0, "expression");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::FunctionCallType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"CallExpression\",\n");
+        print("\"type\": \"CallExpression\",\n");
         visitChild(n, 0, "callee");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"arguments\": ");
+        print("\"arguments\": ");
         n->childAt(1)->apply(this);
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ForLoopType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ForStatement\",\n");
+        print("\"type\": \"ForStatement\",\n");
         visitChild(n, 0, "init");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "test");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 2, "update");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 3, "body");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ForInLoopType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ForInStatement\",\n");
+        print("\"type\": \"ForInStatement\",\n");
         if (n->childAt(0)) {
             // FIXME
         } else {
             printSpaces(indent);
-            fprintf(buffer, "\"left\": {\n");
+            print("\"left\": {\n");
             printSpaces(indent + 1);
-            fprintf(buffer, "\"type\": \"VariableDeclaration\",\n");
+            print("\"type\": \"VariableDeclaration\",\n");
             printSpaces(indent + 1);
-            fprintf(buffer, "\"declarations\": [{\n");
+            print("\"declarations\": [{\n");
             printSpaces(indent + 2);
-            fprintf(buffer, "\"type\": \"VariableDeclarator\",\n");
+            print("\"type\": \"VariableDeclarator\",\n");
             printSpaces(indent + 2);
-            fprintf(buffer, "\"id\": {\n");
+            print("\"id\": {\n");
             printSpaces(indent + 3);
-            fprintf(buffer, "\"type\": \"Identifier\",\n");
+            print("\"type\": \"Identifier\",\n");
             printSpaces(indent + 3);
-            fprintf(buffer, "\"name\": \"");
+            print("\"name\": \"");
             printString(n->identifier().ustring());
-            fprintf(buffer, "\"\n");
+            print("\"\n");
             printSpaces(indent + 2);
-            fprintf(buffer, "},\n");
+            print("},\n");
             printSpaces(indent + 2);
-            fprintf(buffer, "\"init\": null\n");
+            print("\"init\": null\n");
             printSpaces(indent + 1);
-            fprintf(buffer, "}]\n");
+            print("}]\n");
             printSpaces(indent);
-            fprintf(buffer, "},\n");
+            print("},\n");
         }
         visitChild(n, 1, "right");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 2, "body");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"each\": false\n");
+        print("\"each\": false\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::FormalParameterListType) {
-        fprintf(buffer, "{\n");
+        print("{\n");
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Identifier\",\n");
+        print("\"type\": \"Identifier\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"name\": \"");
+        print("\"name\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         printSpaces(indent - 1);
         if (n->childCount()) {
-            fprintf(buffer, "},\n");
+            print("},\n");
             printSpaces(indent - 1);
             for (int i = 0; i < n->childCount(); ++i)
                 n->childAt(i)->apply(this);
         } else {
-            fprintf(buffer, "}");
+            print("}");
         }
         return;
     }
 
     if (n->type() == SyntaxTree::Node::FunctionDeclStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"FunctionExpression\",\n");
+        print("\"type\": \"FunctionExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"id\": \"");
+        print("\"id\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\",\n");
+        print("\",\n");
         printSpaces(indent);
         if (n->childAt(0)) {
-            fprintf(buffer, "\"params\": [");
+            print("\"params\": [");
             indent++;
             n->childAt(0)->apply(this);
             indent--;
-            fprintf(buffer, "],\n");
+            print("],\n");
         } else {
-            fprintf(buffer, "\"params\": [],\n");
+            print("\"params\": [],\n");
         }
         printSpaces(indent);
         visitChild(n, 1, "body");
@@ -523,270 +554,281 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
     if (n->type() == SyntaxTree::Node::FunctionBodyType) {
         if (n->childCount() && n->childAt(0)) {
             n->childAt(0)->apply(this);
+        } else if (n->isUnparsed()) {
+            printSpaces(indent + 1);
+            print("\"type\": \"BlockStatement\",\n");
+            printSpaces(indent + 1);
+            print("\"body\": [],\n");
+            printSpaces(indent + 1);
+            print("\"unparsed\": true\n");
         } else {
             printSpaces(indent + 1);
-            fprintf(buffer, "\"type\": \"BlockStatement\",\n");
+            print("\"type\": \"BlockStatement\",\n");
             printSpaces(indent + 1);
-            fprintf(buffer, "\"body\": []\n");
+            print("\"body\": []\n");
         }
         return;
     }
 
     if (n->type() == SyntaxTree::Node::FunctionExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"FunctionExpression\",\n");
+        print("\"type\": \"FunctionExpression\",\n");
         printSpaces(indent);
         if (n->identifier().ustring().isEmpty()) {
-            fprintf(buffer, "\"id\": null,\n");
+            print("\"id\": null,\n");
         } else {
-            fprintf(buffer, "\"id\": \"");
+            print("\"id\": \"");
             printString(n->identifier().ustring());
-            fprintf(buffer, "\",\n");
+            print("\",\n");
         }
         if (n->childCount() == 0) {
             printSpaces(indent);
-            fprintf(buffer, "\"params\": [],\n");
-            fprintf(buffer, "\"body\": {}\n");
+            print("\"params\": [],\n");
+            print("\"body\": {}\n");
         } else if (n->childCount() == 1) {
             printSpaces(indent);
-            fprintf(buffer, "\"params\": [],\n");
+            print("\"params\": [],\n");
             visitChild(n, 0, "body");
-            fprintf(buffer, "\n");
+            print("\n");
         } else {
             printSpaces(indent);
             if (n->childAt(0)) {
-                fprintf(buffer, "\"params\": [");
+                print("\"params\": [");
                 indent++;
                 n->childAt(0)->apply(this);
                 indent--;
-                fprintf(buffer, "],\n");
+                print("],\n");
             } else {
-                fprintf(buffer, "\"params\": [],\n");
+                print("\"params\": [],\n");
             }
             visitChild(n, 1, "body");
-            fprintf(buffer, "\n");
+            print("\n");
         }
         return;
     }
 
     if (n->type() == SyntaxTree::Node::IdentifierExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Identifier\",\n");
+        print("\"type\": \"Identifier\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"name\": \"");
+        print("\"name\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::IfStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"IfStatement\",\n");
+        print("\"type\": \"IfStatement\",\n");
         visitChild(n, 0, "test");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "consequent");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 2, "alternate");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::NewExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"NewExpression\",\n");
+        print("\"type\": \"NewExpression\",\n");
         visitChild(n, 0, "callee");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"arguments\": ");
+        print("\"arguments\": ");
         n->childAt(1)->apply(this);
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::NullType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Literal\",\n");
+        print("\"type\": \"Literal\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"objtype\": \"Null\",\n");
+        print("\"objtype\": \"Null\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"value\": null\n");
+        print("\"value\": null\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::NumberExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Literal\",\n");
+        print("\"type\": \"Literal\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"objtype\": \"Number\",\n");
+        print("\"objtype\": \"Number\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"value\": \"%g\"\n", n->number());
+        print("\"value\": \"%g\"\n", n->number());
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ObjectLiteralType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ObjectExpression\",\n");
+        print("\"type\": \"ObjectExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"properties\": ");
+        print("\"properties\": ");
         if (n->childCount() && n->childAt(0)->type() == SyntaxTree::Node::PropertyListType) {
             visitAllChildren(n->childAt(0));
         } else {
             visitAllChildren(n);
         }
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::PropertyType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Property\",\n");
+        print("\"type\": \"Property\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"key\": {\n");
+        print("\"key\": {\n");
         printSpaces(indent + 1);
-        fprintf(buffer, "\"type\": \"Identifier\",\n");
+        print("\"type\": \"Identifier\",\n");
         printSpaces(indent + 1);
-        fprintf(buffer, "\"name\": \"");
+        print("\"name\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         printSpaces(indent);
-        fprintf(buffer, "},\n");
+        print("},\n");
         visitChild(n, 0, "value");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::SourceElementsType) {
         if (indent == 0)
-            fprintf(buffer, "{\n");
+            print("{\n");
         indent++;
         printSpaces(indent);
         if (indent == 1)
-            fprintf(buffer, "\"type\": \"Program\",\n");
+            print("\"type\": \"Program\",\n");
         else
-            fprintf(buffer, "\"type\": \"BlockStatement\",\n");
+            print("\"type\": \"BlockStatement\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"body\": ");
+        print("\"body\": ");
         visitAllChildren(n);
         indent--;
-        fprintf(buffer, "\n");
+        print("\n");
         if (indent == 0)
-            fprintf(buffer, "}\n");
+            print("}\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::StringExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Literal\",\n");
+        print("\"type\": \"Literal\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"objtype\": \"String\",\n");
+        print("\"objtype\": \"String\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"value\": \"");
+        print("\"value\": \"");
         printString(n->string());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ThisType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ThisExpression\"\n");
+        print("\"type\": \"ThisExpression\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::UnaryExpressionType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"UnaryExpression\",\n");
+        print("\"type\": \"UnaryExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"%s\",\n", operatorAsText(n->op()));
+        print("\"operator\": \"%s\",\n", operatorAsText(n->op()));
         visitChild(n, 0, "argument");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::PostfixType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"UpdateExpression\",\n");
+        print("\"type\": \"UpdateExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"%s\",\n", operatorAsText(n->op()));
+        print("\"operator\": \"%s\",\n", operatorAsText(n->op()));
         visitChild(n, 0, "argument");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"prefix\": false\n");
+        print("\"prefix\": false\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::PrefixType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"UpdateExpression\",\n");
+        print("\"type\": \"UpdateExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"%s\",\n", operatorAsText(n->op()));
+        print("\"operator\": \"%s\",\n", operatorAsText(n->op()));
         visitChild(n, 0, "argument");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"prefix\": true\n");
+        print("\"prefix\": true\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::RegexType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Literal\",\n");
+        print("\"type\": \"Literal\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"objtype\": \"RegEx\",\n");
+        print("\"objtype\": \"RegEx\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"value\": ");
-        fprintf(buffer, "\"/");
+        print("\"value\": ");
+        print("\"/");
         printString(n->identifier().ustring());
-        fprintf(buffer, "/");
+        print("/");
         printString(n->string());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ResolveType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"Identifier\",\n");
+        print("\"type\": \"Identifier\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"name\": \"");
+        print("\"name\": \"");
         printString(n->identifier().ustring());
-        fprintf(buffer, "\"\n");
+        print("\"\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::ReturnStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ReturnStatement\",\n");
+        print("\"type\": \"ReturnStatement\",\n");
         if (n->childCount() && n->childAt(0)) {
             visitChild(n, 0, "argument");
         } else {
             printSpaces(indent);
-            fprintf(buffer, "\"argument\": null\n");
+            print("\"argument\": null\n");
         }
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::SwitchStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"SwitchStatement\",\n");
+        print("\"type\": \"SwitchStatement\",\n");
         visitChild(n, 0, "discriminant");
-        fprintf(buffer, ",\n");
+        print(",\n");
         printSpaces(indent);
 
         if (n->childAt(1)) {
-            // fold 'default' clause into another
-            SyntaxTree::Node clauses(*n->childAt(1));
+            // fold 'default' clause into another, in a list of its own
+            // so that the tree is left alone
+            ParserArena arena;
+            SyntaxTree::Node clauses(SyntaxTree::Node::ClauseListType);
+            for (int i = 0; i < n->childAt(1)->childCount(); ++i)
+                clauses.append(arena, n->childAt(1)->childAt(i));
             if (n->childAt(2))
-                clauses.append(n->childAt(2));
-            fprintf(buffer, "\"cases\": ");
+                clauses.append(arena, n->childAt(2));
+            print("\"cases\": ");
             clauses.apply(this);
-            fprintf(buffer, "\n");
+            print("\n");
         } else {
             if (n->childAt(2)) {
-                fprintf(buffer, "\"cases\": [{\n");
+                print("\"cases\": [{\n");
                 ++indent;
                 n->childAt(2)->apply(this);
                 --indent;
                 printSpaces(indent);
-                fprintf(buffer, "}]\n");
+                print("}]\n");
             }
         }
         return;
@@ -794,71 +836,71 @@ void JSONTreeDumper::process(SyntaxTree::Node* n)
 
     if (n->type() == SyntaxTree::Node::ThrowStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"ThrowStatement\",\n");
+        print("\"type\": \"ThrowStatement\",\n");
         if (n->childCount() && n->childAt(0)) {
             visitChild(n, 0, "argument");
         } else {
             printSpaces(indent);
-            fprintf(buffer, "\"argument\": null\n");
+            print("\"argument\": null\n");
         }
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::TryStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"TryStatement\",\n");
+        print("\"type\": \"TryStatement\",\n");
         visitChild(n, 0, "block");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "handler");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 2, "finalizer");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::VoidType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"UnaryExpression\",\n");
+        print("\"type\": \"UnaryExpression\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"operator\": \"void\",\n");
+        print("\"operator\": \"void\",\n");
         visitChild(n, 0, "argument");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::WhileStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"WhileStatement\",\n");
+        print("\"type\": \"WhileStatement\",\n");
         visitChild(n, 0, "test");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "body");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::WithStatementType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"WithStatement\",\n");
+        print("\"type\": \"WithStatement\",\n");
         visitChild(n, 0, "object");
-        fprintf(buffer, ",\n");
+        print(",\n");
         visitChild(n, 1, "body");
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     if (n->type() == SyntaxTree::Node::VariableDeclarationType) {
         printSpaces(indent);
-        fprintf(buffer, "\"type\": \"VariableDeclaration\",\n");
+        print("\"type\": \"VariableDeclaration\",\n");
         printSpaces(indent);
-        fprintf(buffer, "\"declarations\": ");
+        print("\"declarations\": ");
         visitAllChildren(n);
-        fprintf(buffer, "\n");
+        print("\n");
         return;
     }
 
     printSpaces(indent);
-    fprintf(buffer, "\"type\": \"Unknown %d\"\n", n->type());
+    print("\"type\": \"Unknown %d\"\n", n->type());
     exit(0);
     return;
 }
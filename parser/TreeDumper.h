@@ -30,10 +30,13 @@
 
 #include <SyntaxTree.h>
 
-#include <limits.h>
+#include <wtf/Vector.h>
 
 namespace JSC {
 
+// Appends printf-style formatted text to a character buffer.
+void appendFormat(Vector<char>& buffer, const char* format, ...);
+
 class JSONTreeDumper: public SyntaxTree::Visitor
 {
 public:
@@ -55,8 +58,10 @@ protected:
     void printString(const UString &str);
 
 private:
-    char fileName[PATH_MAX + 1];
-    FILE* buffer;
+    void print(const char* format, ...);
+
+    // The dump is built in memory, so dumpers on different threads never share a file.
+    Vector<char> buffer;
 };
 
 } // namespace JSC
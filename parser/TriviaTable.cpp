@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "TriviaTable.h"
+
+#include <algorithm>
+
+namespace JSC {
+
+static bool endLessThan(const TriviaTable::Range& range, int offset)
+{
+    return range.end < offset;
+}
+
+static bool startLessThan(const TriviaTable::Range& range, int offset)
+{
+    return range.start < offset;
+}
+
+const TriviaTable::Range* TriviaTable::leadingTrivia(int tokenStart) const
+{
+    const Range* begin = m_leadingTrivia.data();
+    const Range* end = begin + m_leadingTrivia.size();
+    const Range* trivia = std::lower_bound(begin, end, tokenStart, endLessThan);
+    if (trivia == end || trivia->end != tokenStart)
+        return 0;
+    return trivia;
+}
+
+size_t TriviaTable::firstCommentAfter(int offset) const
+{
+    const Range* begin = m_comments.data();
+    return std::lower_bound(begin, begin + m_comments.size(), offset, startLessThan) - begin;
+}
+
+// Comments are ordered by their start and leading trivia by the start of
+// their token, which is where they end.
+static void spliceRanges(Vector<TriviaTable::Range>& ranges, int TriviaTable::Range::* key, int start, int end, int delta, const Vector<TriviaTable::Range>& inserted)
+{
+    Vector<TriviaTable::Range> spliced;
+    spliced.reserveInitialCapacity(ranges.size() + inserted.size());
+
+    size_t i = 0;
+    for (; i < ranges.size() && ranges[i].*key <= start; ++i)
+        spliced.append(ranges[i]);
+    for (size_t j = 0; j < inserted.size(); ++j) {
+        if (inserted[j].*key > start)
+            spliced.append(inserted[j]);
+    }
+    for (; i < ranges.size(); ++i) {
+        if (ranges[i].*key < end)
+            continue;
+        TriviaTable::Range range = { ranges[i].start + delta, ranges[i].end + delta };
+        spliced.append(range);
+    }
+
+    ranges.swap(spliced);
+}
+
+void TriviaTable::splice(int start, int end, int delta, const TriviaTable& trivia)
+{
+    spliceRanges(m_comments, &Range::start, start, end, delta, trivia.m_comments);
+    spliceRanges(m_leadingTrivia, &Range::end, start, end, delta, trivia.m_leadingTrivia);
+}
+
+} // namespace JSC
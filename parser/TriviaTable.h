@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TriviaTable_h
+#define TriviaTable_h
+
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// The comments of a source and the trivia that lead each token, recorded by
+// the lexer as it reads them when asked to, so that formatters and other
+// tools that care about comments need not lex the source a second time.
+// Both are kept as pairs of offsets in the order of the source, and looked up
+// with a binary search.
+//
+// The leading trivia of a token run from the end of the token before it to
+// its start, and hold the white space, line terminators and comments between
+// the two; tokens right after another have none. The trivia at the end of the
+// source lead the end as if it were a token. A semicolon inserted at a
+// line break is not a token here. Text the lexer jumps over, such as skipped
+// function bodies or the rest of a line with a syntax error, belongs to
+// neither a token nor its trivia.
+//
+// The comments that belong to a node are those in the leading trivia of its
+// first token: from firstCommentAfter(leadingTrivia(start)->start) on, up to
+// the start of the node.
+class TriviaTable : public Noncopyable
+{
+public:
+    struct Range {
+        int start;
+        int end;
+    };
+
+    // Forgets everything, keeping the memory.
+    void reset()
+    {
+        m_comments.shrink(0);
+        m_leadingTrivia.shrink(0);
+    }
+
+    // The lexer may be rewound over tokens it has read before, so only
+    // ranges past the last one recorded are new.
+    void addComment(int start, int end)
+    {
+        if (m_comments.isEmpty() || start > m_comments.last().start) {
+            Range comment = { start, end };
+            m_comments.append(comment);
+        }
+    }
+
+    void addLeadingTrivia(int start, int tokenStart)
+    {
+        if (start < tokenStart && (m_leadingTrivia.isEmpty() || tokenStart > m_leadingTrivia.last().end)) {
+            Range trivia = { start, tokenStart };
+            m_leadingTrivia.append(trivia);
+        }
+    }
+
+    // Line comments run from the // (or the <!-- or --> that also start
+    // them) up to the line terminator, block comments from /* past */. The
+    // source tells them apart.
+    const Vector<Range>& comments() const { return m_comments; }
+    const Vector<Range>& leadingTrivia() const { return m_leadingTrivia; }
+
+    // The leading trivia of the token that starts at the offset, or 0 if it
+    // has none.
+    const Range* leadingTrivia(int tokenStart) const;
+
+    // The index of the first comment that starts at or after the offset, or
+    // the number of comments if there is none.
+    size_t firstCommentAfter(int offset) const;
+
+    // After the characters from start to end were replaced by delta more
+    // characters and relexed into trivia: drops the ranges recorded inside
+    // the old range, adds those of trivia, and moves the later ones.
+    void splice(int start, int end, int delta, const TriviaTable& trivia);
+
+private:
+    Vector<Range> m_comments;
+    Vector<Range> m_leadingTrivia;
+};
+
+} // namespace JSC
+
+#endif // TriviaTable_h
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include "WorkStealingPool.h"
+
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace JSC {
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount)
+    : m_function(0)
+    , m_context(0)
+    , m_pending(0)
+{
+    if (!threadCount) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = processors > 0 ? processors : 1;
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_queues.append(new Queue);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    for (size_t i = 0; i < m_queues.size(); ++i)
+        delete m_queues[i];
+}
+
+void WorkStealingPool::add(void* item, unsigned workerIndex)
+{
+    // Count the item before it becomes visible, so that no worker can see
+    // an empty pool while this item is still outstanding.
+    __sync_add_and_fetch(&m_pending, 1);
+
+    Queue* queue = m_queues[workerIndex % m_queues.size()];
+    pthread_mutex_lock(&queue->lock);
+    queue->items.append(item);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+bool WorkStealingPool::takeOwn(unsigned index, void*& item)
+{
+    Queue* queue = m_queues[index];
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->head < queue->items.size();
+    if (found) {
+        item = queue->items.last();
+        queue->items.removeLast();
+        if (queue->head == queue->items.size()) {
+            queue->items.shrink(0);
+            queue->head = 0;
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+bool WorkStealingPool::steal(unsigned index, void*& item)
+{
+    size_t count = m_queues.size();
+    for (size_t i = 1; i < count; ++i) {
+        Queue* queue = m_queues[(index + i) % count];
+        pthread_mutex_lock(&queue->lock);
+        bool found = queue->head < queue->items.size();
+        if (found)
+            item = queue->items[queue->head++];
+        pthread_mutex_unlock(&queue->lock);
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(unsigned index)
+{
+    while (true) {
+        void* item;
+        if (takeOwn(index, item) || steal(index, item)) {
+            m_function(item, index, m_context);
+            __sync_sub_and_fetch(&m_pending, 1);
+            continue;
+        }
+        if (!__sync_add_and_fetch(&m_pending, 0))
+            return;
+        sched_yield();
+    }
+}
+
+void* WorkStealingPool::workerMain(void* argument)
+{
+    WorkerContext* context = static_cast<WorkerContext*>(argument);
+    context->pool->work(context->index);
+    return 0;
+}
+
+void WorkStealingPool::run(Function function, void* context)
+{
+    m_function = function;
+    m_context = context;
+
+    unsigned count = threadCount();
+    Vector<pthread_t> threads(count);
+    Vector<WorkerContext> contexts(count);
+    unsigned started = 1;
+    for (unsigned i = 1; i < count; ++i) {
+        contexts[i].pool = this;
+        contexts[i].index = i;
+        if (pthread_create(&threads[i], 0, workerMain, &contexts[i]))
+            break;
+        started++;
+    }
+
+    // If a thread could not be created, its queue is simply stolen from.
+    work(0);
+
+    for (unsigned i = 1; i < started; ++i)
+        pthread_join(threads[i], 0);
+
+    m_function = 0;
+    m_context = 0;
+}
+
+} // namespace JSC
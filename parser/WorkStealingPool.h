@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WorkStealingPool_h
+#define WorkStealingPool_h
+
+#include <pthread.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+
+// Runs a batch of independent work items on a set of threads. Every worker
+// owns a queue: it takes work from the back of its own queue and, once that
+// is empty, steals from the front of the others. Items may be added before
+// run() and by running tasks; run() returns when all of them are done.
+class WorkStealingPool : public Noncopyable {
+public:
+    typedef void (*Function)(void* item, unsigned workerIndex, void* context);
+
+    // A thread count of 0 means one worker per online processor.
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();
+
+    unsigned threadCount() const { return m_queues.size(); }
+
+    // Queues an item on the given worker. From inside a task, pass the
+    // worker index the task was called with.
+    void add(void* item, unsigned workerIndex);
+
+    // Processes every queued item. The calling thread acts as worker 0.
+    void run(Function, void* context);
+
+private:
+    struct Queue {
+        Queue()
+            : head(0)
+        {
+            pthread_mutex_init(&lock, 0);
+        }
+
+        ~Queue()
+        {
+            pthread_mutex_destroy(&lock);
+        }
+
+        pthread_mutex_t lock;
+        Vector<void*> items;
+        size_t head;
+    };
+
+    struct WorkerContext {
+        WorkStealingPool* pool;
+        unsigned index;
+    };
+
+    static void* workerMain(void*);
+    void work(unsigned index);
+    bool takeOwn(unsigned index, void*& item);
+    bool steal(unsigned index, void*& item);
+
+    Vector<Queue*> m_queues;
+    Function m_function;
+    void* m_context;
+    long m_pending;
+};
+
+} // namespace JSC
+
+#endif // WorkStealingPool_h
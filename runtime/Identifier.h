@@ -28,12 +28,32 @@ namespace JSC {
     class JSGlobalData;
     class UString;
 
+    // The characters of an Identifier that is constructed in place, for example
+    // by IdentifierArena, so that no temporary Identifier is copied.
+    template <typename T>
+    struct IdentifierCharacters {
+        IdentifierCharacters(const T* characters, size_t length, UString::CharacterOwnership ownership)
+            : characters(characters)
+            , length(length)
+            , ownership(ownership)
+        {
+        }
+
+        const T* characters;
+        size_t length;
+        UString::CharacterOwnership ownership;
+    };
+
     class Identifier {
     public:
 
         Identifier() { }
+        Identifier(JSGlobalData*, const LChar* chars, size_t len): m_string(chars, len) { }
         Identifier(JSGlobalData*, const UChar* chars, size_t len): m_string(chars, len) { }
         Identifier(JSGlobalData*, const UString &id): m_string(id) { }
+        // Latin1 characters are always widened into a copy.
+        Identifier(const IdentifierCharacters<LChar>& source): m_string(source.characters, source.length) { }
+        Identifier(const IdentifierCharacters<UChar>& source): m_string(source.characters, source.length, source.ownership) { }
 
         const UString& ustring() const { return m_string; }
         const UString& impl() const { return m_string; }
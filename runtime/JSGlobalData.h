@@ -44,7 +44,7 @@ namespace JSC {
             , emptyIdentifier(globalData, "")
             , underscoreProto(globalData, "__proto__")
             , thisIdentifier(globalData, "this")
-            , arguments(globalData, "argument")
+            , arguments(globalData, "arguments")
             , get(globalData, "get")
             , set(globalData, "set")
         {
@@ -65,13 +65,11 @@ namespace JSC {
     class JSGlobalData
     {
     public:
-        Lexer* lexer;
         Parser* parser;
         CommonIdentifiers* propertyNames;
 
         JSGlobalData()
-            : lexer(new Lexer(this))
-            , parser(new Parser)
+            : parser(new Parser)
             , propertyNames(new CommonIdentifiers(this))
         {
         }
@@ -80,7 +78,6 @@ namespace JSC {
         {
             delete propertyNames;
             delete parser;
-            delete lexer;
         }
     };
 
@@ -37,17 +37,20 @@ public:
     UString()
         : m_length(0)
         , m_data(0)
+        , m_ownsCharacters(true)
     {
     }
 
     ~UString()
     {
-        delete [] m_data;
+        if (m_ownsCharacters)
+            delete [] m_data;
     }
 
     UString(const UString &other)
         : m_length(other.m_length)
         , m_data(0)
+        , m_ownsCharacters(true)
     {
         m_length = other.m_length;
         if (m_length) {
@@ -59,8 +62,10 @@ public:
     UString& operator=(const UString &other)
     {
         if (&other != this) {
-            delete [] m_data;
+            if (m_ownsCharacters)
+                delete [] m_data;
             m_data = 0;
+            m_ownsCharacters = true;
             m_length = other.m_length;
             if (m_length) {
                 m_data = new UChar[m_length];
@@ -74,6 +79,7 @@ public:
     UString(const UChar* characters, unsigned length)
         : m_length(0)
         , m_data(0)
+        , m_ownsCharacters(true)
     {
         if (characters && length) {
             m_length = length;
@@ -82,10 +88,31 @@ public:
         }
     }
 
+    enum CharacterOwnership { CopyCharacters, ShareCharacters };
+
+    // Construct a string with UTF-16 data. With ShareCharacters the string refers
+    // to the characters instead of copying them, so they must outlive it; copies
+    // of the string always own their characters.
+    UString(const UChar* characters, unsigned length, CharacterOwnership ownership)
+        : m_length(0)
+        , m_data(0)
+        , m_ownsCharacters(ownership == CopyCharacters)
+    {
+        if (characters && length) {
+            m_length = length;
+            if (m_ownsCharacters) {
+                m_data = new UChar[length];
+                memcpy(m_data, characters, length * sizeof(UChar));
+            } else
+                m_data = const_cast<UChar*>(characters);
+        }
+    }
+
     // Construct a string with latin1 data, from a null-terminated source.
     UString(const char* characters)
         : m_length(0)
         , m_data(0)
+        , m_ownsCharacters(true)
     {
         if (characters) {
             m_length = strlen(characters);
@@ -99,6 +126,21 @@ public:
     UString(const char* characters, unsigned length)
         : m_length(0)
         , m_data(0)
+        , m_ownsCharacters(true)
+    {
+        if (characters && length) {
+            m_length = length;
+            m_data = new UChar[m_length];
+            for (unsigned i = 0; i < m_length; ++i)
+                m_data[i] = characters[i];
+        }
+    }
+
+    // Construct a string with latin1 data, without sign-extending characters above 0x7F.
+    UString(const LChar* characters, unsigned length)
+        : m_length(0)
+        , m_data(0)
+        , m_ownsCharacters(true)
     {
         if (characters && length) {
             m_length = length;
@@ -113,6 +155,7 @@ public:
     unsigned length() const { return m_length; }
 
     const UChar* characters() const { return m_data; }
+    bool ownsCharacters() const { return m_ownsCharacters; }
 
     UChar operator[](unsigned index) const { return (!m_data || index >= m_length) ? 0 : m_data[index]; }
 
@@ -127,6 +170,7 @@ public:
 private:
     unsigned m_length;
     UChar* m_data;
+    bool m_ownsCharacters;
 };
 
 ALWAYS_INLINE bool operator==(const UString& s1, const UString& s2)
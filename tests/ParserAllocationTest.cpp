@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Parses a script into a Program twice and checks that the second parse
+// does not allocate, with every option that promises so. Allocations are
+// counted by replacing malloc, calloc and realloc, which needs glibc.
+
+#include "config.h"
+
+#include <JSGlobalData.h>
+#include <Parser.h>
+#include <SourceCode.h>
+#include <SyntaxTree.h>
+#include <UString.h>
+
+#include <stdio.h>
+#include <string.h>
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+static bool countingAllocations;
+static size_t allocationCount;
+
+extern "C" void* malloc(size_t size)
+{
+    if (countingAllocations)
+        ++allocationCount;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    if (countingAllocations)
+        ++allocationCount;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    if (countingAllocations)
+        ++allocationCount;
+    return __libc_realloc(pointer, size);
+}
+
+using namespace JSC;
+
+static const char script[] =
+    "// Line comment\n"
+    "/* Block\n   comment */\n"
+    "var counter = 0, name = 'single \\'quoted\\'', other = \"double \\u0041\\n\";\n"
+    "var \\u0061lias = 1.5e3 + 0x1F + 017 + .25;\n"
+    "function outer(a, b, c) {\n"
+    "    var local = { key: a, 'quoted': b, 42: c, 'default': function () { return local.key; } };\n"
+    "    function inner(x) {\n"
+    "        with (local) { counter += x; }\n"
+    "        return arguments.length > 1 ? eval('x') : typeof x === 'string';\n"
+    "    }\n"
+    "    for (var i = 0; i < 10; ++i) {\n"
+    "        if (i % 2) continue; else if (i > 8) break;\n"
+    "        inner(i);\n"
+    "    }\n"
+    "    for (var p in local) delete local[p];\n"
+    "    try { throw new Error(name + other); } catch (e) { counter = -counter; } finally { counter >>>= 1; }\n"
+    "    switch (a) { case 1: case 'two': b = [1, , 3, [4, 5]]; break; default: b = null; }\n"
+    "    do { c = c && !c || void 0; } while (c instanceof Object);\n"
+    "    return /ab+c[\\]/]/gi.test(name) ? function (y) { return y * 2; } : this;\n"
+    "}\n"
+    "outer(1, 'two', { three: [3] });\n"
+    "label: while (counter < 100) { counter++; if (counter == 50) break label; }\n";
+
+static bool parsesWithoutAllocating(JSGlobalData* globalData, const SourceCode& source, unsigned options, const char* description)
+{
+    SyntaxTree::Program program;
+    if (!globalData->parser->parse(globalData, source, program, options)) {
+        printf("FAIL: %s, options %u: the script does not parse\n", description, options);
+        return false;
+    }
+
+    allocationCount = 0;
+    countingAllocations = true;
+    bool parsed = globalData->parser->parse(globalData, source, program, options);
+    countingAllocations = false;
+
+    if (!parsed) {
+        printf("FAIL: %s, options %u: the script does not parse again\n", description, options);
+        return false;
+    }
+    if (allocationCount) {
+        printf("FAIL: %s, options %u: the second parse allocated %lu times\n", description, options, static_cast<unsigned long>(allocationCount));
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    // ParallelFunctionBodies starts threads, so it is left out.
+    static const unsigned optionSets[] = {
+        Parser::NoParseOptions,
+        Parser::FoldConstants,
+        Parser::LazyFunctionBodies,
+        Parser::RecoverFromErrors,
+        Parser::RecordTrivia,
+        Parser::FoldConstants | Parser::LazyFunctionBodies | Parser::RecordTrivia
+    };
+
+    JSGlobalData* globalData = new JSGlobalData;
+    SourceCode source8 = makeSource(reinterpret_cast<const LChar*>(script), strlen(script));
+    SourceCode source16 = makeSource(UString(script));
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(optionSets) / sizeof(optionSets[0]); ++i) {
+        if (!parsesWithoutAllocating(globalData, source8, optionSets[i], "8-bit source"))
+            ++failures;
+        if (!parsesWithoutAllocating(globalData, source16, optionSets[i], "UTF-16 source"))
+            ++failures;
+    }
+
+    delete globalData;
+
+    if (failures)
+        return 1;
+    printf("PASS\n");
+    return 0;
+}
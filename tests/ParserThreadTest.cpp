@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Parses the same scripts from several threads at once through one shared
+// JSGlobalData, with every parse option, and checks that each thread gets
+// the tree a single-threaded parse gives. Build with -fsanitize=thread to
+// have data races reported as well.
+
+#include "config.h"
+
+#include <JSGlobalData.h>
+#include <Parser.h>
+#include <SourceCode.h>
+#include <UString.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <wtf/Vector.h>
+
+using namespace JSC;
+
+static const char* const scripts[] = {
+    "var counter = 0, name = 'single \\'quoted\\'', other = \"double \\u0041\\n\";\n"
+    "function outer(a, b, c) {\n"
+    "    var local = { key: a, 'quoted': b, 42: c, 'default': function () { return local.key; } };\n"
+    "    function inner(x) {\n"
+    "        with (local) { counter += x; }\n"
+    "        return arguments.length > 1 ? eval('x') : typeof x === 'string';\n"
+    "    }\n"
+    "    for (var i = 0; i < 10; ++i) { if (i % 2) continue; inner(i); }\n"
+    "    try { throw new Error(name + other); } catch (e) { counter = -counter; }\n"
+    "    return /ab+c[\\]/]/gi.test(name) ? function (y) { return y * 2 + 'x'; } : this;\n"
+    "}\n",
+
+    "// Many small functions, for the parallel parse to spread over workers.\n"
+    "var table = {\n"
+    "    one: function (a) { return a + 1; },\n"
+    "    two: function (a, b) { var c = a * b; return c - 2; },\n"
+    "    three: function () { return [1, 2, 3].map(function (x) { return x * x; }); },\n"
+    "    four: function (s) { /* comment */ return s.replace(/a/g, 'b'); },\n"
+    "    five: function (o) { for (var k in o) if (o.hasOwnProperty(k)) delete o[k]; return o; },\n"
+    "    six: function (n) { switch (n) { case 0: return 'zero'; default: return 1 + 2 * 3; } }\n"
+    "};\n"
+    "function seven() { return function eight() { return function nine() { return 9; }; }; }\n",
+
+    "var ok = 1;\n"
+    "var broken = function ( { return; };\n"
+    "var fine = function () { return ok; };\n",
+
+    "// Slashes that skipping a body has to tell apart, and one it misreads.\n"
+    "function f() { if (a) /}/.exec(b); while (f(a)) /)/.test(b); return (a) / 2; }\n"
+    "function g() { function h() { for (;;) /{/g; } return {} / ')'; }\n"
+    "z = 1;\n"
+};
+
+static const unsigned optionSets[] = {
+    Parser::NoParseOptions,
+    Parser::FoldConstants,
+    Parser::LazyFunctionBodies,
+    Parser::ParallelFunctionBodies,
+    Parser::RecoverFromErrors,
+    Parser::RecordTrivia,
+    Parser::FoldConstants | Parser::ParallelFunctionBodies
+};
+
+// Indices into optionSets.
+static const size_t eagerOptionSet = 0;
+static const size_t parallelOptionSet = 3;
+
+static const size_t scriptCount = sizeof(scripts) / sizeof(scripts[0]);
+static const size_t optionSetCount = sizeof(optionSets) / sizeof(optionSets[0]);
+static const int threadCount = 4;
+static const int iterationCount = 20;
+
+static JSGlobalData* globalData;
+static UString expectedTrees[scriptCount][optionSetCount];
+static int expectedErrorLines[scriptCount][optionSetCount];
+static int failureCount;
+
+static UString parse(size_t script, size_t optionSet, int& errorLine)
+{
+    SourceCode source = makeSource(reinterpret_cast<const LChar*>(scripts[script]), strlen(scripts[script]));
+    UString errorMessage;
+    return globalData->parser->createSyntaxTree(globalData, source, optionSets[optionSet], &errorLine, &errorMessage);
+}
+
+static void* parseRepeatedly(void* context)
+{
+    size_t first = reinterpret_cast<size_t>(context);
+    for (int iteration = 0; iteration < iterationCount; ++iteration) {
+        // Start each thread at a different combination, so that different
+        // parses run side by side.
+        for (size_t i = 0; i < scriptCount * optionSetCount; ++i) {
+            size_t combination = (first + i) % (scriptCount * optionSetCount);
+            size_t script = combination / optionSetCount;
+            size_t optionSet = combination % optionSetCount;
+            int errorLine;
+            UString tree = parse(script, optionSet, errorLine);
+            if (tree != expectedTrees[script][optionSet] || errorLine != expectedErrorLines[script][optionSet]) {
+                printf("FAIL: script %lu, options %u: the tree differs from a single-threaded parse\n", static_cast<unsigned long>(script), optionSets[optionSet]);
+                __sync_add_and_fetch(&failureCount, 1);
+            }
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    globalData = new JSGlobalData;
+
+    for (size_t script = 0; script < scriptCount; ++script) {
+        for (size_t optionSet = 0; optionSet < optionSetCount; ++optionSet)
+            expectedTrees[script][optionSet] = parse(script, optionSet, expectedErrorLines[script][optionSet]);
+        // Bodies parsed in parallel are first skipped, which must not change the tree.
+        if (expectedTrees[script][parallelOptionSet] != expectedTrees[script][eagerOptionSet]
+            || expectedErrorLines[script][parallelOptionSet] != expectedErrorLines[script][eagerOptionSet]) {
+            printf("FAIL: script %lu: the tree differs when bodies are parsed in parallel\n", static_cast<unsigned long>(script));
+            ++failureCount;
+        }
+    }
+
+    Vector<pthread_t> threads(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        if (pthread_create(&threads[i], 0, parseRepeatedly, reinterpret_cast<void*>(static_cast<size_t>(i) * 5))) {
+            printf("FAIL: cannot start a thread\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < threadCount; ++i)
+        pthread_join(threads[i], 0);
+
+    delete globalData;
+
+    if (failureCount)
+        return 1;
+    printf("PASS\n");
+    return 0;
+}
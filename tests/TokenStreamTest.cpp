@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Edits a source one keystroke at a time and checks after each edit that
+// TokenStream::relex() gives the tokens that lexing the edited source from
+// scratch gives, and that a keystroke in a long source relexes only the
+// tokens around it.
+
+#include "config.h"
+
+#include <JSGlobalData.h>
+#include <TokenStream.h>
+#include <UString.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <wtf/Vector.h>
+
+using namespace JSC;
+
+static const char* const line =
+    "function f(a, b) { if (a) /}/.exec(b); var s = 'x' + \"y\" / 2; return [a] / b; } // done\r\n";
+static const int lineCount = 10000;
+
+// A keystroke relexes the token it lands in and a few around it.
+static const size_t maxTokensPerKeystroke = 20;
+
+struct Edit {
+    const char* text;
+    int removedLength;
+    // Whether the edit changes the tokens up to the end of the source, as
+    // opening or closing a comment can.
+    bool reachesEnd;
+};
+
+static const Edit edits[] = {
+    { "x", 0, false },
+    { "\n", 0, false },
+    { "\r", 0, false },
+    { "", 1, false },
+    { "/", 0, false },
+    { "'", 0, false },
+    { "/*", 0, true },
+    { "*/", 0, true },
+    { "(", 0, false },
+    { ")", 0, false },
+    { "return\n", 0, false },
+    { "", 3, false }
+};
+
+static JSGlobalData* globalData;
+static int failureCount;
+
+static bool sameTokens(const Vector<TokenStream::Token>& tokens, const Vector<TokenStream::Token>& expected)
+{
+    if (tokens.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const TokenStream::Token& token = tokens[i];
+        const TokenStream::Token& other = expected[i];
+        if (token.type != other.type || token.start != other.start || token.end != other.end || token.line != other.line
+            || !token.before.isResynchronizedWith(other.before, 0, 0))
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    globalData = new JSGlobalData;
+
+    Vector<UChar> text;
+    for (int i = 0; i < lineCount; ++i) {
+        for (const char* c = line; *c; ++c)
+            text.append(*c);
+    }
+
+    TokenStream stream;
+    stream.lex(globalData, makeSource(UString(text.data(), text.size())));
+
+    // Spread the edits over the source, away from its ends.
+    unsigned position = 12345;
+    for (size_t i = 0; i < 10 * sizeof(edits) / sizeof(edits[0]); ++i) {
+        const Edit& edit = edits[i % (sizeof(edits) / sizeof(edits[0]))];
+        position = (position * 1103515245 + 12345) % 0x7fffffff;
+        int offset = text.size() / 4 + position % (text.size() / 2);
+
+        Vector<UChar> inserted;
+        for (const char* c = edit.text; *c; ++c)
+            inserted.append(*c);
+        text.remove(offset, edit.removedLength);
+        text.insert(offset, inserted.data(), inserted.size());
+
+        SourceCode source = makeSource(UString(text.data(), text.size()));
+        size_t relexed = stream.relex(globalData, source, SourceEdit(offset, edit.removedLength, UString(inserted.data(), inserted.size())));
+        TokenStream expected;
+        expected.lex(globalData, source);
+
+        if (!sameTokens(stream.tokens(), expected.tokens())) {
+            printf("FAIL: edit %lu at %d: the tokens differ from lexing the edited source\n", static_cast<unsigned long>(i), offset);
+            ++failureCount;
+            stream.lex(globalData, source);
+        } else if (!edit.reachesEnd && relexed > maxTokensPerKeystroke) {
+            printf("FAIL: edit %lu at %d: %lu tokens relexed\n", static_cast<unsigned long>(i), offset, static_cast<unsigned long>(relexed));
+            ++failureCount;
+        }
+    }
+
+    delete globalData;
+
+    if (failureCount)
+        return 1;
+    printf("PASS\n");
+    return 0;
+}
@@ -30,6 +30,7 @@
 
 #include <stdint.h>
 
+typedef unsigned char LChar;
 typedef uint16_t UChar;
 typedef uint32_t UChar32;
 
@@ -39,6 +40,8 @@ typedef uint32_t UChar32;
 #define COMPILER(WTF_FEATURE) (defined WTF_COMPILER_##WTF_FEATURE  && WTF_COMPILER_##WTF_FEATURE)
 /* CPU() - the target CPU architecture */
 #define CPU(WTF_FEATURE) (defined WTF_CPU_##WTF_FEATURE  && WTF_CPU_##WTF_FEATURE)
+/* ENABLE() - turn on a specific feature of the project */
+#define ENABLE(WTF_FEATURE) (defined ENABLE_##WTF_FEATURE  && ENABLE_##WTF_FEATURE)
 
 /* ==== COMPILER() - the compiler being used to build the project ==== */
 
@@ -141,6 +144,16 @@ typedef uint32_t UChar32;
 #define WTF_CPU_X86_64 1
 #endif
 
+/* CPU(X86_SSE2) - SSE2 support */
+#if defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+#define WTF_CPU_X86_SSE2 1
+#endif
+
+/* CPU(X86_AVX2) - AVX2 support, when the target enables it (e.g. -mavx2) */
+#if defined(__AVX2__)
+#define WTF_CPU_X86_AVX2 1
+#endif
+
 /* CPU(ARM) - ARM, any version*/
 #if   defined(arm) \
     || defined(__arm__) \
@@ -163,4 +176,11 @@ typedef uint32_t UChar32;
 #endif
 
 
+/* ==== ENABLE() - features that are off unless the build turns them on ==== */
+
+/* ENABLE(PARSER_PROFILING) - count calls and cycles per parser production and token type */
+#if !defined(ENABLE_PARSER_PROFILING)
+#define ENABLE_PARSER_PROFILING 0
+#endif
+
 #endif /* WTF_Platform_h */
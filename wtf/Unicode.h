@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2011 Sencha, Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY APPLE INC. AND ITS CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL APPLE INC. OR ITS CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WTF_Unicode_h
+#define WTF_Unicode_h
+
+#include <wtf/AlwaysInline.h>
+#include <wtf/UnicodeTables.h>
+
+namespace WTF {
+namespace Unicode {
+
+// Character properties of single UTF-16 code units, looked up in the tables
+// generated by create_unicode_tables. Values outside the Basic Multilingual
+// Plane, such as the -1 end-of-input marker, have none of the properties.
+
+ALWAYS_INLINE bool testUnicodeTable(const unsigned char* index, const unsigned char (*bits)[(1 << unicodeTableBlockShift) / 8], int c)
+{
+    if (static_cast<unsigned>(c) > 0xFFFF)
+        return false;
+    const unsigned char* block = bits[index[c >> unicodeTableBlockShift]];
+    unsigned offset = c & ((1 << unicodeTableBlockShift) - 1);
+    return (block[offset >> 3] >> (offset & 7)) & 1;
+}
+
+// ECMA-262 5th edition, 7.6: UnicodeLetter.
+inline bool isIdentifierStart(int c)
+{
+    return testUnicodeTable(identifierStartIndex, identifierStartBits, c);
+}
+
+// ECMA-262 5th edition, 7.6: UnicodeLetter, UnicodeCombiningMark, UnicodeDigit,
+// UnicodeConnectorPunctuation, <ZWNJ> and <ZWJ>.
+inline bool isIdentifierPart(int c)
+{
+    return testUnicodeTable(identifierPartIndex, identifierPartBits, c);
+}
+
+// General category Zs.
+inline bool isSeparatorSpace(int c)
+{
+    return testUnicodeTable(separatorSpaceIndex, separatorSpaceBits, c);
+}
+
+} // namespace Unicode
+} // namespace WTF
+
+#endif // WTF_Unicode_h
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <limits>
+#include <string.h>
 #include <utility>
 
 #include <wtf/AlwaysInline.h>
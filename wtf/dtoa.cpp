@@ -123,6 +123,7 @@
 #define NO_ERRNO
 
 #include <math.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -558,12 +559,15 @@ struct P5Node : Noncopyable {
     P5Node* next;
 };
     
+// The cache of powers of five is shared by every thread; nodes are only ever
+// appended, so the list may be walked without the lock once its length is read.
 static P5Node* p5s;
 static int p5sCount;
+static pthread_mutex_t p5sMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static ALWAYS_INLINE void pow5mult(BigInt& b, int k)
 {
-    static int p05[3] = { 5, 25, 125 };
+    static const int p05[3] = { 5, 25, 125 };
 
     if (int i = k & 3)
         multadd(b, p05[i - 1], 0);
@@ -571,6 +575,7 @@ static ALWAYS_INLINE void pow5mult(BigInt& b, int k)
     if (!(k >>= 2))
         return;
 
+    pthread_mutex_lock(&p5sMutex);
     P5Node* p5 = p5s;
 
     if (!p5) {
@@ -583,6 +588,7 @@ static ALWAYS_INLINE void pow5mult(BigInt& b, int k)
     }
 
     int p5sCountLocal = p5sCount;
+    pthread_mutex_unlock(&p5sMutex);
     int p5sUsed = 0;
 
     for (;;) {
@@ -593,6 +599,7 @@ static ALWAYS_INLINE void pow5mult(BigInt& b, int k)
             break;
 
         if (++p5sUsed == p5sCountLocal) {
+            pthread_mutex_lock(&p5sMutex);
             if (p5sUsed == p5sCount) {
                 ASSERT(!p5->next);
                 p5->next = new P5Node;
@@ -603,6 +610,7 @@ static ALWAYS_INLINE void pow5mult(BigInt& b, int k)
             }
             
             p5sCountLocal = p5sCount;
+            pthread_mutex_unlock(&p5sMutex);
         }
         p5 = p5->next;
     }